@@ -6,40 +6,134 @@
 #include <iostream>
 #include <random>
 #include <atomic>
+#include <algorithm>
+#include <memory>
+#include <new>
+#include <utility>
+#include <type_traits>
+#include <cstring>
+#ifdef __linux__
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
 
-#define BUFFER_SIZE 5
+// Tags selecting the synchronization of ThreadSafeCircularBuffer:
+//     ThreadSafeCircularBuffer<T, N>             any number of producers and consumers
+//     ThreadSafeCircularBuffer<T, N, SpscMode>   one producer thread, one consumer thread
+//     ThreadSafeCircularBuffer<T, N, MpmcMode>   lock-free, any number of producers and consumers
+//     ThreadSafeCircularBuffer<T, N, MirroredMode>   SPSC over double-mapped memory (Linux)
+struct MutexMode {};
+struct SpscMode {};
+struct MpmcMode {};
+struct MirroredMode {};
 
+// Contiguous run of items inside a ring; a window that wraps around the end of
+// the ring is returned as two of these.
+template <typename T>
+struct Span {
+    T* data = nullptr;
+    size_t length = 0;
+
+    T* begin() const { return data; }
+    T* end() const { return data + length; }
+    size_t size() const { return length; }
+    bool empty() const { return length == 0; }
+    T& operator[](size_t i) const { return data[i]; }
+};
+
+template <typename T>
+struct SpanPair {
+    Span<T> first;
+    Span<T> second; // non-empty only when the window wraps
+
+    size_t size() const { return first.size() + second.size(); }
+    bool empty() const { return size() == 0; }
+};
+
+// Bounded blocking ring of N items of type T. Slots are raw storage aligned for T:
+// an item is constructed on push and destroyed on pop, so T need not be
+// default-constructible or copyable. A power-of-two N wraps indices with a mask;
+// any other N wraps with a compare instead of a division.
+template <typename T, size_t N = 5, typename Mode = MutexMode>
 class ThreadSafeCircularBuffer {
+    static_assert(N > 0, "capacity must be positive");
+
 private:
-    int buffer[BUFFER_SIZE];
-    int in = 0, out = 0, count = 0;
+    alignas(T) unsigned char storage[N * sizeof(T)];
+    size_t in = 0, out = 0, count = 0;
     bool closed = false;
     mutable std::mutex mtx;
     std::condition_variable not_full, not_empty;
 
-public:
-    // push blocks until space is available or buffer is closed.
-    // returns false if buffer was closed.
-    bool push(int value) {
+    // raw memory of slot i, the target of placement new
+    void* slot(size_t i) {
+        return storage + i * sizeof(T);
+    }
+
+    // the live item in slot i
+    T* item(size_t i) {
+        return std::launder(static_cast<T*>(slot(i)));
+    }
+
+    static size_t next(size_t i) {
+        if constexpr ((N & (N - 1)) == 0) {
+            return (i + 1) & (N - 1);
+        } else {
+            return i + 1 == N ? 0 : i + 1;
+        }
+    }
+
+    template <typename... Args>
+    bool insert(Args&&... args) {
         std::unique_lock<std::mutex> lock(mtx);
-        not_full.wait(lock, [this] { return count < BUFFER_SIZE || closed; });
+        not_full.wait(lock, [this] { return count < N || closed; });
         if (closed) return false;
-        buffer[in] = value;
-        in = (in + 1) % BUFFER_SIZE;
+        ::new (slot(in)) T(std::forward<Args>(args)...);
+        in = next(in);
         ++count;
         lock.unlock();
         not_empty.notify_one();
         return true;
     }
 
+public:
+    ThreadSafeCircularBuffer() = default;
+
+    ~ThreadSafeCircularBuffer() {
+        for (; count > 0; --count) {
+            item(out)->~T();
+            out = next(out);
+        }
+    }
+
+    static constexpr size_t capacity() { return N; }
+
+    // push blocks until space is available or buffer is closed.
+    // returns false if buffer was closed.
+    bool push(const T& value) {
+        return insert(value);
+    }
+
+    bool push(T&& value) {
+        return insert(std::move(value));
+    }
+
+    // emplace constructs the item in place; same blocking and return as push.
+    template <typename... Args>
+    bool emplace(Args&&... args) {
+        return insert(std::forward<Args>(args)...);
+    }
+
     // pop blocks until an item is available or buffer is closed and empty.
     // returns false if buffer closed and no items remain.
-    bool pop(int& value) {
+    bool pop(T& value) {
         std::unique_lock<std::mutex> lock(mtx);
         not_empty.wait(lock, [this] { return count > 0 || closed; });
         if (count == 0) return false; // closed && empty
-        value = buffer[out];
-        out = (out + 1) % BUFFER_SIZE;
+        T* front = item(out);
+        value = std::move(*front);
+        front->~T();
+        out = next(out);
         --count;
         lock.unlock();
         not_full.notify_one();
@@ -53,7 +147,7 @@ public:
 
     bool full() const {
         std::lock_guard<std::mutex> lock(mtx);
-        return count == BUFFER_SIZE;
+        return count == N;
     }
 
     void close() {
@@ -67,12 +161,588 @@ public:
 
     size_t size() const {
         std::lock_guard<std::mutex> lock(mtx);
-        return static_cast<size_t>(count);
+        return count;
+    }
+};
+
+// Lock-free single-producer/single-consumer ring.
+// Exactly one thread may push and exactly one (other) thread may pop. The
+// consumer-owned head and producer-owned tail sit on separate cache lines, and each
+// side keeps a cached copy of the other's index, re-reading the shared line only
+// when the ring looks full/empty. Items are handed over with acquire/release.
+// push/pop spin on try_push/try_pop for SPIN_LIMIT attempts, then yield for
+// YIELD_LIMIT more, before parking on a condition variable. Every call that
+// publishes an index (try_*, push/pop, commit/release) checks a parked flag and
+// only touches the mutex if the other side is asleep, so blocking and
+// non-blocking calls can be mixed freely. close() sets the top bit of tail and the
+// producer publishes with a CAS, so a push either lands before the close or fails.
+// N must be a power of two.
+template <typename T, size_t N>
+class ThreadSafeCircularBuffer<T, N, SpscMode> {
+    static_assert(N > 0 && (N & (N - 1)) == 0, "SPSC capacity must be a power of two");
+
+private:
+    static constexpr size_t MASK = N - 1;
+    static constexpr size_t CLOSED = size_t(1) << (sizeof(size_t) * 8 - 1);
+    static constexpr int SPIN_LIMIT = 256;
+    static constexpr int YIELD_LIMIT = 16;
+
+    alignas(64) std::atomic<size_t> head{0};
+    size_t cached_tail = 0; // consumer-local
+    alignas(64) std::atomic<size_t> tail{0}; // CLOSED bit | next position to fill
+    size_t cached_head = 0; // producer-local
+    alignas(64) std::atomic<bool> producer_parked{false};
+    std::atomic<bool> consumer_parked{false};
+    std::mutex park_mtx;
+    std::condition_variable not_full, not_empty;
+    alignas(64) alignas(T) unsigned char storage[N * sizeof(T)];
+
+    bool is_closed() const {
+        return (tail.load(std::memory_order_acquire) & CLOSED) != 0;
+    }
+
+    // raw memory of slot i, the target of placement new
+    void* slot(size_t i) {
+        return storage + (i & MASK) * sizeof(T);
+    }
+
+    // the live item in slot i
+    T* item(size_t i) {
+        return std::launder(static_cast<T*>(slot(i)));
+    }
+
+    // the n slots starting at position pos, split where the ring wraps
+    SpanPair<T> window(size_t pos, size_t n) {
+        T* base = reinterpret_cast<T*>(storage);
+        size_t first = std::min(n, N - (pos & MASK));
+        return SpanPair<T>{Span<T>{base + (pos & MASK), first}, Span<T>{base, n - first}};
+    }
+
+    // called after publishing an index; the fence pairs with the one in park()
+    void wake(std::atomic<bool>& parked, std::condition_variable& cv) {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (parked.load(std::memory_order_relaxed)) {
+            { std::lock_guard<std::mutex> lock(park_mtx); }
+            cv.notify_one();
+        }
+    }
+
+    template <typename Ready>
+    void park(std::atomic<bool>& parked, std::condition_variable& cv, Ready ready) {
+        std::unique_lock<std::mutex> lock(park_mtx);
+        parked.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        cv.wait(lock, [&] { return ready() || is_closed(); });
+        parked.store(false, std::memory_order_relaxed);
+    }
+
+    template <typename... Args>
+    bool insert(Args&&... args) {
+        for (int spins = 0;; ++spins) {
+            if (try_emplace(std::forward<Args>(args)...)) return true;
+            if (is_closed()) return false;
+            if (spins >= SPIN_LIMIT + YIELD_LIMIT) {
+                park(producer_parked, not_full, [this] {
+                    return (tail.load(std::memory_order_relaxed) & ~CLOSED) - head.load(std::memory_order_acquire) < N;
+                });
+                spins = 0;
+            } else if (spins >= SPIN_LIMIT) {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+public:
+    ThreadSafeCircularBuffer() = default;
+
+    ~ThreadSafeCircularBuffer() {
+        size_t end = tail.load(std::memory_order_relaxed) & ~CLOSED;
+        for (size_t i = head.load(std::memory_order_relaxed); i != end; ++i) item(i)->~T();
+    }
+
+    static constexpr size_t capacity() { return N; }
+
+    // producer only. try_emplace constructs the item in place if there is room;
+    // returns false if the ring is full or closed. The item is published by a CAS
+    // on tail, so it either lands before close() (and is delivered) or fails; a
+    // close() racing with it destroys the just-built item, consuming an rvalue
+    // argument even though false is returned.
+    template <typename... Args>
+    bool try_emplace(Args&&... args) {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (t & CLOSED) return false;
+        if (t - cached_head == N) {
+            cached_head = head.load(std::memory_order_acquire);
+            if (t - cached_head == N) return false;
+        }
+        ::new (slot(t)) T(std::forward<Args>(args)...);
+        size_t expected = t;
+        if (!tail.compare_exchange_strong(expected, t + 1, std::memory_order_release, std::memory_order_relaxed)) {
+            item(t)->~T(); // only close() writes tail besides us
+            return false;
+        }
+        wake(consumer_parked, not_empty);
+        return true;
+    }
+
+    // producer only
+    bool try_push(const T& value) {
+        return try_emplace(value);
+    }
+
+    bool try_push(T&& value) {
+        return try_emplace(std::move(value));
+    }
+
+    // consumer only. try_pop returns false if the ring is empty.
+    bool try_pop(T& value) {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (h == cached_tail) {
+            cached_tail = tail.load(std::memory_order_acquire) & ~CLOSED;
+            if (h == cached_tail) return false;
+        }
+        T* front = item(h);
+        value = std::move(*front);
+        front->~T();
+        head.store(h + 1, std::memory_order_release);
+        wake(producer_parked, not_full);
+        return true;
+    }
+
+    // producer only. push blocks until space is available or buffer is closed.
+    // returns false if buffer was closed.
+    bool push(const T& value) {
+        return insert(value);
+    }
+
+    bool push(T&& value) {
+        return insert(std::move(value));
+    }
+
+    // consumer only. pop blocks until an item is available or buffer is closed and empty.
+    // returns false if buffer closed and no items remain.
+    bool pop(T& value) {
+        for (int spins = 0;; ++spins) {
+            if (try_pop(value)) return true;
+            if (is_closed()) {
+                // close() is ordered after every successful publish, so this
+                // try_pop sees all items pushed before it
+                return try_pop(value);
+            }
+            if (spins >= SPIN_LIMIT + YIELD_LIMIT) {
+                park(consumer_parked, not_empty, [this] {
+                    return (tail.load(std::memory_order_acquire) & ~CLOSED) != head.load(std::memory_order_relaxed);
+                });
+                spins = 0;
+            } else if (spins >= SPIN_LIMIT) {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    // Zero-copy access for trivially copyable T (e.g. bytes of serialized packets).
+    // producer only. reserve returns up to n free slots, as one or two spans, to be
+    // written in place; commit(k) then publishes the first k of them (k <= reserved),
+    // or returns false without publishing anything if the ring has been closed.
+    SpanPair<T> reserve(size_t n) {
+        static_assert(std::is_trivially_copyable<T>::value, "reserve/commit need trivially copyable items");
+        size_t t = tail.load(std::memory_order_relaxed) & ~CLOSED;
+        if (N - (t - cached_head) < n) cached_head = head.load(std::memory_order_acquire);
+        return window(t, std::min(n, N - (t - cached_head)));
+    }
+
+    bool commit(size_t n) {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (t & CLOSED) return false;
+        if (!tail.compare_exchange_strong(t, t + n, std::memory_order_release, std::memory_order_relaxed)) return false;
+        wake(consumer_parked, not_empty);
+        return true;
+    }
+
+    // consumer only. peek returns up to n published items, as one or two spans, to be
+    // read in place; release(k) then frees the first k of them (k <= peeked).
+    SpanPair<T> peek(size_t n) {
+        static_assert(std::is_trivially_copyable<T>::value, "peek/release need trivially copyable items");
+        size_t h = head.load(std::memory_order_relaxed);
+        if (cached_tail - h < n) cached_tail = tail.load(std::memory_order_acquire) & ~CLOSED;
+        return window(h, std::min(n, cached_tail - h));
+    }
+
+    void release(size_t n) {
+        head.store(head.load(std::memory_order_relaxed) + n, std::memory_order_release);
+        wake(producer_parked, not_full);
+    }
+
+    void close() {
+        tail.fetch_or(CLOSED, std::memory_order_acq_rel);
+        { std::lock_guard<std::mutex> lock(park_mtx); }
+        not_empty.notify_all();
+        not_full.notify_all();
+    }
+
+    // size, empty and full are approximate while the producer and consumer are running
+    size_t size() const {
+        size_t h = head.load(std::memory_order_acquire);
+        size_t t = tail.load(std::memory_order_acquire) & ~CLOSED;
+        return t > h ? t - h : 0;
+    }
+
+    bool empty() const {
+        return size() == 0;
+    }
+
+    bool full() const {
+        return size() == N;
+    }
+};
+
+// Lock-free bounded multi-producer/multi-consumer ring (Vyukov).
+// Every cell carries a sequence number telling which lap of the ring it is ready
+// for: a producer may fill cell pos & MASK when its sequence equals pos, a consumer
+// may empty it when the sequence equals pos + 1. Producers claim positions by CAS on
+// enqueue_pos and consumers on dequeue_pos, each counter on its own cache line, so
+// the two sides never contend with each other. close() sets the top bit of
+// enqueue_pos, which makes every later claim fail; pop keeps delivering until the
+// consumers have caught up with the last claimed position. push/pop spin, yield,
+// then park exactly like the SPSC ring, and every call that publishes a cell
+// (try_* included) wakes a parked peer, so blocking and non-blocking calls mix
+// freely. N must be a power of two.
+template <typename T, size_t N>
+class ThreadSafeCircularBuffer<T, N, MpmcMode> {
+    static_assert(N > 0 && (N & (N - 1)) == 0, "MPMC capacity must be a power of two");
+
+private:
+    static constexpr size_t MASK = N - 1;
+    static constexpr size_t CLOSED = size_t(1) << (sizeof(size_t) * 8 - 1);
+    static constexpr int SPIN_LIMIT = 256;
+    static constexpr int YIELD_LIMIT = 16;
+
+    struct Cell {
+        std::atomic<size_t> sequence;
+        alignas(T) unsigned char storage[sizeof(T)];
+
+        T* item() { return std::launder(reinterpret_cast<T*>(storage)); }
+    };
+
+    alignas(64) std::atomic<size_t> enqueue_pos{0}; // CLOSED bit | next position to fill
+    alignas(64) std::atomic<size_t> dequeue_pos{0};
+    alignas(64) std::atomic<int> producers_parked{0};
+    std::atomic<int> consumers_parked{0};
+    std::mutex park_mtx;
+    std::condition_variable not_full, not_empty;
+    alignas(64) Cell cells[N];
+
+    static intptr_t distance(size_t sequence, size_t pos) {
+        return static_cast<intptr_t>(sequence - pos);
+    }
+
+    bool is_closed() const {
+        return (enqueue_pos.load(std::memory_order_acquire) & CLOSED) != 0;
+    }
+
+    bool can_push() const {
+        size_t pos = enqueue_pos.load(std::memory_order_relaxed) & ~CLOSED;
+        return distance(cells[pos & MASK].sequence.load(std::memory_order_acquire), pos) >= 0;
+    }
+
+    bool can_pop() const {
+        size_t pos = dequeue_pos.load(std::memory_order_relaxed);
+        return distance(cells[pos & MASK].sequence.load(std::memory_order_acquire), pos + 1) >= 0;
+    }
+
+    // called after publishing a cell; the fence pairs with the one in park()
+    void wake(std::atomic<int>& parked, std::condition_variable& cv) {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (parked.load(std::memory_order_relaxed) > 0) {
+            { std::lock_guard<std::mutex> lock(park_mtx); }
+            cv.notify_one();
+        }
+    }
+
+    template <typename Ready>
+    void park(std::atomic<int>& parked, std::condition_variable& cv, Ready ready) {
+        std::unique_lock<std::mutex> lock(park_mtx);
+        parked.fetch_add(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        cv.wait(lock, [&] { return ready() || is_closed(); });
+        parked.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    template <typename... Args>
+    bool insert(Args&&... args) {
+        for (int spins = 0;; ++spins) {
+            if (try_emplace(std::forward<Args>(args)...)) return true;
+            if (is_closed()) return false;
+            if (spins >= SPIN_LIMIT + YIELD_LIMIT) {
+                park(producers_parked, not_full, [this] { return can_push(); });
+                spins = 0;
+            } else if (spins >= SPIN_LIMIT) {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+public:
+    ThreadSafeCircularBuffer() {
+        for (size_t i = 0; i < N; ++i) cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    ~ThreadSafeCircularBuffer() {
+        size_t end = enqueue_pos.load(std::memory_order_relaxed) & ~CLOSED;
+        for (size_t i = dequeue_pos.load(std::memory_order_relaxed); i != end; ++i) cells[i & MASK].item()->~T();
+    }
+
+    static constexpr size_t capacity() { return N; }
+
+    // try_emplace constructs the item in place if there is room;
+    // returns false if the ring is full or closed.
+    template <typename... Args>
+    bool try_emplace(Args&&... args) {
+        size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+        Cell* cell;
+        while (true) {
+            if (pos & CLOSED) return false;
+            cell = &cells[pos & MASK];
+            intptr_t diff = distance(cell->sequence.load(std::memory_order_acquire), pos);
+            if (diff == 0) {
+                if (enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+            } else if (diff < 0) {
+                return false; // the cell still holds the previous lap's item: full
+            } else {
+                pos = enqueue_pos.load(std::memory_order_relaxed);
+            }
+        }
+        ::new (static_cast<void*>(cell->storage)) T(std::forward<Args>(args)...);
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        wake(consumers_parked, not_empty);
+        return true;
+    }
+
+    bool try_push(const T& value) {
+        return try_emplace(value);
+    }
+
+    bool try_push(T&& value) {
+        return try_emplace(std::move(value));
+    }
+
+    // try_pop returns false if no item is ready.
+    bool try_pop(T& value) {
+        size_t pos = dequeue_pos.load(std::memory_order_relaxed);
+        Cell* cell;
+        while (true) {
+            cell = &cells[pos & MASK];
+            intptr_t diff = distance(cell->sequence.load(std::memory_order_acquire), pos + 1);
+            if (diff == 0) {
+                if (dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+            } else if (diff < 0) {
+                return false; // not yet filled for this lap: empty
+            } else {
+                pos = dequeue_pos.load(std::memory_order_relaxed);
+            }
+        }
+        T* item = cell->item();
+        value = std::move(*item);
+        item->~T();
+        cell->sequence.store(pos + N, std::memory_order_release);
+        wake(producers_parked, not_full);
+        return true;
+    }
+
+    // push blocks until space is available or buffer is closed.
+    // returns false if buffer was closed.
+    bool push(const T& value) {
+        return insert(value);
+    }
+
+    bool push(T&& value) {
+        return insert(std::move(value));
+    }
+
+    // pop blocks until an item is available or buffer is closed and empty.
+    // returns false if buffer closed and no items remain.
+    bool pop(T& value) {
+        for (int spins = 0;; ++spins) {
+            if (try_pop(value)) return true;
+            size_t end = enqueue_pos.load(std::memory_order_acquire);
+            if (end & CLOSED) {
+                // no position can be claimed any more; wait only for claimed ones
+                if (dequeue_pos.load(std::memory_order_relaxed) == (end & ~CLOSED)) return false;
+                std::this_thread::yield();
+                continue;
+            }
+            if (spins >= SPIN_LIMIT + YIELD_LIMIT) {
+                park(consumers_parked, not_empty, [this] { return can_pop(); });
+                spins = 0;
+            } else if (spins >= SPIN_LIMIT) {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    void close() {
+        enqueue_pos.fetch_or(CLOSED, std::memory_order_acq_rel);
+        { std::lock_guard<std::mutex> lock(park_mtx); }
+        not_empty.notify_all();
+        not_full.notify_all();
+    }
+
+    // size, empty and full are approximate while producers and consumers are running
+    size_t size() const {
+        size_t out = dequeue_pos.load(std::memory_order_acquire);
+        size_t in = enqueue_pos.load(std::memory_order_acquire) & ~CLOSED;
+        return in > out ? in - out : 0;
+    }
+
+    bool empty() const {
+        return size() == 0;
+    }
+
+    bool full() const {
+        return size() >= N;
+    }
+};
+
+#ifdef __linux__
+// Double-mapped ("magic") single-producer/single-consumer ring, Linux only.
+// The N * sizeof(T) bytes of a memfd are mapped twice, back to back, so slot
+// i + N aliases slot i: every window of up to N items is one contiguous span, even
+// across the wrap point. reserve/peek therefore return a single Span that can be
+// handed straight to a parser, memcpy, or read(2)/write(2). Indices follow the
+// SPSC ring (padded, cached, acquire/release); the calls never block. Mapping can
+// fail (no memfd, size not a multiple of the page size), so check valid() after
+// construction. N must be a power of two and T trivially copyable.
+template <typename T, size_t N>
+class ThreadSafeCircularBuffer<T, N, MirroredMode> {
+    static_assert(N > 0 && (N & (N - 1)) == 0, "mirrored capacity must be a power of two");
+    static_assert(std::is_trivially_copyable<T>::value, "mirrored ring items must be trivially copyable");
+
+private:
+    static constexpr size_t MASK = N - 1;
+    static constexpr size_t BYTES = N * sizeof(T);
+
+    alignas(64) std::atomic<size_t> head{0};
+    size_t cached_tail = 0; // consumer-local
+    alignas(64) std::atomic<size_t> tail{0};
+    size_t cached_head = 0; // producer-local
+    alignas(64) T* base = nullptr; // 2 * N slots, the second half aliasing the first
+
+public:
+    ThreadSafeCircularBuffer() {
+        if (BYTES % static_cast<size_t>(sysconf(_SC_PAGESIZE)) != 0) return;
+        int fd = memfd_create("ThreadSafeCircularBuffer", MFD_CLOEXEC);
+        if (fd < 0) return;
+        if (ftruncate(fd, BYTES) != 0) {
+            ::close(fd);
+            return;
+        }
+        // reserve 2 * BYTES of address space, then map the file over both halves
+        void* area = mmap(nullptr, 2 * BYTES, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (area != MAP_FAILED) {
+            char* lower = static_cast<char*>(area);
+            if (mmap(lower, BYTES, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) != MAP_FAILED &&
+                mmap(lower + BYTES, BYTES, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) != MAP_FAILED) {
+                base = reinterpret_cast<T*>(lower);
+            } else {
+                munmap(area, 2 * BYTES);
+            }
+        }
+        ::close(fd); // the mappings keep the pages alive
+    }
+
+    ~ThreadSafeCircularBuffer() {
+        if (base) munmap(base, 2 * BYTES);
+    }
+
+    ThreadSafeCircularBuffer(const ThreadSafeCircularBuffer&) = delete;
+    ThreadSafeCircularBuffer& operator=(const ThreadSafeCircularBuffer&) = delete;
+
+    // valid returns false if the double mapping could not be set up.
+    bool valid() const { return base != nullptr; }
+
+    static constexpr size_t capacity() { return N; }
+
+    // producer only. reserve returns up to n free slots as one contiguous span;
+    // commit(k) then publishes the first k of them (k <= reserved).
+    Span<T> reserve(size_t n) {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (N - (t - cached_head) < n) cached_head = head.load(std::memory_order_acquire);
+        return Span<T>{base + (t & MASK), std::min(n, N - (t - cached_head))};
+    }
+
+    void commit(size_t n) {
+        tail.store(tail.load(std::memory_order_relaxed) + n, std::memory_order_release);
+    }
+
+    // consumer only. peek returns up to n published items as one contiguous span;
+    // release(k) then frees the first k of them (k <= peeked).
+    Span<T> peek(size_t n) {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (cached_tail - h < n) cached_tail = tail.load(std::memory_order_acquire);
+        return Span<T>{base + (h & MASK), std::min(n, cached_tail - h)};
+    }
+
+    void release(size_t n) {
+        head.store(head.load(std::memory_order_relaxed) + n, std::memory_order_release);
+    }
+
+    // producer only. write copies up to n items in with one memcpy; returns how many fit.
+    size_t write(const T* data, size_t n) {
+        Span<T> span = reserve(n);
+        std::memcpy(span.data, data, span.size() * sizeof(T));
+        commit(span.size());
+        return span.size();
+    }
+
+    // consumer only. read copies up to n items out with one memcpy; returns how many.
+    size_t read(T* data, size_t n) {
+        Span<T> span = peek(n);
+        std::memcpy(data, span.data, span.size() * sizeof(T));
+        release(span.size());
+        return span.size();
+    }
+
+    // producer only. read_from fills free space with one read(2) on fd.
+    // returns the read(2) result: bytes added, 0 at end of file, -1 on error.
+    ssize_t read_from(int fd) {
+        static_assert(sizeof(T) == 1, "read_from works on byte rings");
+        Span<T> span = reserve(N);
+        if (span.empty()) return 0;
+        ssize_t got = ::read(fd, span.data, span.size());
+        if (got > 0) commit(static_cast<size_t>(got));
+        return got;
+    }
+
+    // consumer only. write_to drains published bytes with one write(2) on fd.
+    // returns the write(2) result: bytes removed, or -1 on error.
+    ssize_t write_to(int fd) {
+        static_assert(sizeof(T) == 1, "write_to works on byte rings");
+        Span<T> span = peek(N);
+        if (span.empty()) return 0;
+        ssize_t sent = ::write(fd, span.data, span.size());
+        if (sent > 0) release(static_cast<size_t>(sent));
+        return sent;
+    }
+
+    // size, empty and full are approximate while the producer and consumer are running
+    size_t size() const {
+        size_t h = head.load(std::memory_order_acquire);
+        size_t t = tail.load(std::memory_order_acquire);
+        return t > h ? t - h : 0;
+    }
+
+    bool empty() const {
+        return size() == 0;
+    }
+
+    bool full() const {
+        return size() == N;
     }
 };
+#endif
 
 void circularBufferTest() {
-    ThreadSafeCircularBuffer cb;
+    ThreadSafeCircularBuffer<int, 5> cb;
     std::vector<std::thread> producers, consumers;
 
     const int NUM_PRODUCERS = 3;
@@ -133,7 +803,232 @@ void circularBufferTest() {
               << " final_size=" << cb.size() << "\n";
 }
 
+// move-only items go through the buffer without copies or default construction
+void moveOnlyBufferTest() {
+    ThreadSafeCircularBuffer<std::unique_ptr<int>, 8> cb;
+    const int ITEMS = 100;
+    std::thread producer([&cb]() {
+        for (int i = 0; i < ITEMS; ++i) cb.push(std::make_unique<int>(i));
+        cb.close();
+    });
+    long sum = 0;
+    std::unique_ptr<int> item;
+    while (cb.pop(item)) sum += *item;
+    producer.join();
+    std::cout << "Move-only buffer: sum=" << sum << " (expected " << ITEMS * (ITEMS - 1) / 2 << ")\n";
+}
+
+// Blocking and non-blocking calls on the two ends of a lock-free ring: a producer
+// parked in push() must be woken by a consumer that only polls with try_pop, and a
+// consumer parked in pop() by a producer that only uses try_push.
+template <typename Ring>
+void mixedBlockingRun(const char* name) {
+    const int ITEMS = 1000;
+
+    Ring blocking_producer;
+    std::thread producer([&blocking_producer, ITEMS]() {
+        for (int i = 0; i < ITEMS; ++i) blocking_producer.push(i);
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50)); // let the producer park on a full ring
+    int received = 0, value;
+    while (received < ITEMS) {
+        if (blocking_producer.try_pop(value)) ++received;
+        else std::this_thread::yield();
+    }
+    producer.join();
+    std::cout << name << " push() producer, try_pop() consumer: " << received << "/" << ITEMS << " items\n";
+
+    Ring blocking_consumer;
+    std::thread consumer([&blocking_consumer, &received]() {
+        int item;
+        received = 0;
+        while (blocking_consumer.pop(item)) ++received;
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50)); // let the consumer park on an empty ring
+    for (int i = 0; i < ITEMS; ++i) {
+        while (!blocking_consumer.try_push(i)) std::this_thread::yield();
+    }
+    blocking_consumer.close();
+    consumer.join();
+    std::cout << name << " try_push() producer, pop() consumer: " << received << "/" << ITEMS << " items\n";
+}
+
+void mixedBlockingTest() {
+    mixedBlockingRun<ThreadSafeCircularBuffer<int, 8, SpscMode>>("spsc");
+    mixedBlockingRun<ThreadSafeCircularBuffer<int, 8, MpmcMode>>("mpmc");
+}
+
+// Streams length-prefixed records of bytes through the SPSC ring without an
+// intermediate buffer: the producer serializes each record straight into reserved
+// space and the consumer checks it in place, both across the wrap point.
+void zeroCopyRecordTest() {
+    using Ring = ThreadSafeCircularBuffer<unsigned char, 4096, SpscMode>;
+    const int RECORDS = 2000;
+    const size_t MAX_PAYLOAD = 1500;
+    Ring ring;
+
+    std::thread producer([&ring, RECORDS, MAX_PAYLOAD]() {
+        std::mt19937 gen(5);
+        std::uniform_int_distribution<size_t> length(1, MAX_PAYLOAD);
+        for (int r = 0; r < RECORDS; ++r) {
+            size_t payload = length(gen);
+            size_t record = 2 + payload;
+            SpanPair<unsigned char> spans = ring.reserve(record);
+            while (spans.size() < record) {
+                std::this_thread::yield();
+                spans = ring.reserve(record);
+            }
+            // byte k of the record lands in the first span, then continues in the second
+            for (size_t k = 0; k < record; ++k) {
+                unsigned char byte = k == 0 ? payload & 0xFF : k == 1 ? payload >> 8 : static_cast<unsigned char>(r + k);
+                if (k < spans.first.size()) spans.first[k] = byte;
+                else spans.second[k - spans.first.size()] = byte;
+            }
+            ring.commit(record);
+        }
+    });
+
+    int good = 0;
+    for (int r = 0; r < RECORDS; ++r) {
+        auto at = [](const SpanPair<unsigned char>& spans, size_t k) {
+            return k < spans.first.size() ? spans.first[k] : spans.second[k - spans.first.size()];
+        };
+        SpanPair<unsigned char> spans = ring.peek(2);
+        while (spans.size() < 2) {
+            std::this_thread::yield();
+            spans = ring.peek(2);
+        }
+        size_t record = 2 + (at(spans, 0) | static_cast<size_t>(at(spans, 1)) << 8);
+        spans = ring.peek(record);
+        while (spans.size() < record) {
+            std::this_thread::yield();
+            spans = ring.peek(record);
+        }
+        bool ok = true;
+        for (size_t k = 2; k < record; ++k) ok &= at(spans, k) == static_cast<unsigned char>(r + k);
+        good += ok;
+        ring.release(record);
+    }
+    producer.join();
+    std::cout << "Zero-copy records: " << good << "/" << RECORDS << " intact\n";
+}
+
+#ifdef __linux__
+// Records that straddle the end of a mirrored ring are still one span: each is
+// written with a single memcpy, sent through a pipe with a single write(2), read
+// back with a single read(2), and checked in place.
+void mirroredRingTest() {
+    ThreadSafeCircularBuffer<unsigned char, 4096, MirroredMode> out_ring, in_ring;
+    int fds[2];
+    if (!out_ring.valid() || !in_ring.valid() || pipe(fds) != 0) {
+        std::cout << "Mirrored ring unavailable\n";
+        return;
+    }
+    const int RECORDS = 50;
+    const size_t RECORD = 1000; // does not divide 4096, so records keep straddling the end
+    std::vector<unsigned char> record(RECORD);
+    int straddling = 0, good = 0;
+    for (int r = 0; r < RECORDS; ++r) {
+        for (size_t k = 0; k < RECORD; ++k) record[k] = static_cast<unsigned char>(r * 31 + k);
+        straddling += (r * RECORD) % out_ring.capacity() + RECORD > out_ring.capacity();
+        out_ring.write(record.data(), RECORD);
+        size_t sent = 0;
+        while (sent < RECORD) sent += static_cast<size_t>(out_ring.write_to(fds[1]));
+        size_t received = 0;
+        while (received < RECORD) received += static_cast<size_t>(in_ring.read_from(fds[0]));
+        Span<unsigned char> view = in_ring.peek(RECORD);
+        good += view.size() == RECORD && std::memcmp(view.data, record.data(), RECORD) == 0;
+        in_ring.release(view.size());
+    }
+    ::close(fds[0]);
+    ::close(fds[1]);
+    std::cout << "Mirrored ring: " << good << "/" << RECORDS << " records intact, " << straddling
+              << " straddled the wrap point\n";
+}
+#endif
+
+// Ping-pong between two threads through a pair of buffers; reports one-way
+// handoff latency averaged over round_trips.
+template <typename Buffer>
+double handoffLatencyNs(int round_trips) {
+    Buffer ping, pong;
+    std::thread echo([&ping, &pong, round_trips]() {
+        int token = 0;
+        for (int i = 0; i < round_trips; ++i) {
+            ping.pop(token);
+            pong.push(token);
+        }
+    });
+
+    auto start = std::chrono::steady_clock::now();
+    int token = 0;
+    for (int i = 0; i < round_trips; ++i) {
+        ping.push(i);
+        pong.pop(token);
+    }
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    echo.join();
+    return elapsed.count() / round_trips / 2;
+}
+
+void spscLatencyBenchmark() {
+    const int ROUND_TRIPS = 20000;
+    std::cout << "\nHandoff latency\n";
+    std::cout << "mutex buffer: " << handoffLatencyNs<ThreadSafeCircularBuffer<int, 64>>(ROUND_TRIPS) << " ns/handoff\n";
+    std::cout << "spsc buffer:  " << handoffLatencyNs<ThreadSafeCircularBuffer<int, 64, SpscMode>>(ROUND_TRIPS)
+              << " ns/handoff\n";
+}
+
+// Contended throughput: producers push items_per_producer items each while consumers
+// pop until the buffer is closed and drained.
+template <typename Buffer>
+double bufferThroughput(int num_producers, int num_consumers, int items_per_producer) {
+    Buffer buffer;
+    std::vector<std::thread> producers, consumers;
+    auto start = std::chrono::steady_clock::now();
+    for (int c = 0; c < num_consumers; ++c) {
+        consumers.emplace_back([&buffer]() {
+            int value;
+            while (buffer.pop(value)) {
+            }
+        });
+    }
+    for (int p = 0; p < num_producers; ++p) {
+        producers.emplace_back([&buffer, items_per_producer]() {
+            for (int i = 0; i < items_per_producer; ++i) buffer.push(i);
+        });
+    }
+    for (auto& t : producers) t.join();
+    buffer.close();
+    for (auto& t : consumers) t.join();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return num_producers * items_per_producer / elapsed.count();
+}
+
+void mpmcThroughputBenchmark() {
+    const int ITEMS_PER_PRODUCER = 200000;
+    const int configs[][2] = {{1, 1}, {3, 2}, {4, 4}};
+
+    std::cout << "\nContended throughput (capacity 1024)\n";
+    for (const auto& config : configs) {
+        int producers = config[0], consumers = config[1];
+        double locked = bufferThroughput<ThreadSafeCircularBuffer<int, 1024>>(producers, consumers, ITEMS_PER_PRODUCER);
+        double lock_free =
+            bufferThroughput<ThreadSafeCircularBuffer<int, 1024, MpmcMode>>(producers, consumers, ITEMS_PER_PRODUCER);
+        std::cout << producers << "P/" << consumers << "C  mutex+condvar: " << static_cast<long>(locked)
+                  << " items/s  mpmc ring: " << static_cast<long>(lock_free) << " items/s\n";
+    }
+}
+
 int main() {
     circularBufferTest();
+    moveOnlyBufferTest();
+    mixedBlockingTest();
+    zeroCopyRecordTest();
+#ifdef __linux__
+    mirroredRingTest();
+#endif
+    spscLatencyBenchmark();
+    mpmcThroughputBenchmark();
     return 0;
 }
\ No newline at end of file
@@ -1,60 +1,1950 @@
 #include <queue>
 #include <mutex>
+#include <condition_variable>
 #include <thread>
 #include <vector>
 #include <chrono>
 #include <iostream>
 #include <random>
 #include <atomic>
+#include <algorithm>
+#include <functional>
+#include <optional>
+#include <memory>
+#include <cstdint>
+#include <deque>
+#include <new>
+#include <utility>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
 
+// std::allocator replacement that places every allocation on a cache-line boundary.
+template <typename T>
+struct CacheAlignedAllocator {
+    using value_type = T;
+    static constexpr size_t ALIGNMENT = 64;
+
+    CacheAlignedAllocator() = default;
+    template <typename U>
+    CacheAlignedAllocator(const CacheAlignedAllocator<U>&) {}
+
+    T* allocate(size_t n) {
+        return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t(ALIGNMENT)));
+    }
+
+    void deallocate(T* p, size_t) {
+        ::operator delete(p, std::align_val_t(ALIGNMENT));
+    }
+
+    template <typename U>
+    bool operator==(const CacheAlignedAllocator<U>&) const { return true; }
+    template <typename U>
+    bool operator!=(const CacheAlignedAllocator<U>&) const { return false; }
+};
+
+// Implicit D-ary max-heap (with respect to Compare) with the std::priority_queue
+// interface. A wider node means log_D(n) levels instead of log_2(n), and the D
+// children of a node are stored contiguously. The first D - 1 slots of the
+// cache-aligned container are padding, which makes every sibling group start on a
+// multiple of D elements: when D * sizeof(T) divides 64 each group sits in exactly
+// one cache line, so a sift-down level costs one miss. Padding slots are
+// default-constructed, so T must be default-constructible.
+template <typename T, size_t D = 4, typename Compare = std::less<T>,
+          typename Container = std::vector<T, CacheAlignedAllocator<T>>>
+class DaryHeap {
+    static_assert(D >= 2, "a heap needs at least two children per node");
+
+private:
+    static constexpr size_t ROOT = D - 1;
+
+    Container c;
+    Compare comp;
+
+    static size_t parent(size_t i) { return i / D + D - 2; }
+    static size_t first_child(size_t i) { return D * (i + 2 - D); }
+
+    void sift_up(size_t i) {
+        T item = std::move(c[i]);
+        while (i > ROOT) {
+            size_t p = parent(i);
+            if (!comp(c[p], item)) break;
+            c[i] = std::move(c[p]);
+            i = p;
+        }
+        c[i] = std::move(item);
+    }
+
+    void sift_down(size_t i) {
+        const size_t n = c.size();
+        T item = std::move(c[i]);
+        while (true) {
+            size_t first = first_child(i);
+            if (first >= n) break;
+            size_t last = std::min(first + D, n);
+            size_t best = first;
+            for (size_t k = first + 1; k < last; ++k) {
+                if (comp(c[best], c[k])) best = k;
+            }
+            if (!comp(item, c[best])) break;
+            c[i] = std::move(c[best]);
+            i = best;
+        }
+        c[i] = std::move(item);
+    }
+
+public:
+    using value_type = T;
+    using size_type = size_t;
+    using container_type = Container;
+    using value_compare = Compare;
+
+    explicit DaryHeap(const Compare& compare = Compare()) : c(ROOT), comp(compare) {}
+
+    const T& top() const { return c[ROOT]; }
+    bool empty() const { return c.size() == ROOT; }
+    size_t size() const { return c.size() - ROOT; }
+
+    void push(const T& value) {
+        c.push_back(value);
+        sift_up(c.size() - 1);
+    }
+
+    void push(T&& value) {
+        c.push_back(std::move(value));
+        sift_up(c.size() - 1);
+    }
+
+    template <typename... Args>
+    void emplace(Args&&... args) {
+        c.emplace_back(std::forward<Args>(args)...);
+        sift_up(c.size() - 1);
+    }
+
+    void pop() {
+        if (c.size() > ROOT + 1) {
+            c[ROOT] = std::move(c.back());
+            c.pop_back();
+            sift_down(ROOT);
+        } else {
+            c.pop_back();
+        }
+    }
+
+    // take_top moves the top item out and removes it.
+    T take_top() {
+        T value = std::move(c[ROOT]);
+        pop();
+        return value;
+    }
+
+    // push_range appends [first, last). Large batches are heapified bottom-up
+    // (Floyd) in O(n + k) instead of k sift-ups.
+    template <typename InputIt>
+    void push_range(InputIt first, InputIt last) {
+        size_t old_size = c.size();
+        c.insert(c.end(), first, last);
+        size_t added = c.size() - old_size;
+        if (added > (old_size - ROOT) / 4) {
+            if (c.size() > ROOT + 1) {
+                for (size_t i = parent(c.size() - 1) + 1; i-- > ROOT;) sift_down(i);
+            }
+        } else {
+            for (size_t i = old_size; i < c.size(); ++i) sift_up(i);
+        }
+    }
+
+    // merge moves every item of other into this heap, leaving other empty. O(n + m).
+    void merge(DaryHeap& other) {
+        push_range(std::make_move_iterator(other.c.begin() + ROOT), std::make_move_iterator(other.c.end()));
+        other.c.resize(ROOT);
+    }
+};
+
+// Pairing max-heap (with respect to Compare) with the std::priority_queue interface
+// plus an O(1) merge. Each node holds its children as a singly-linked list: push
+// and merge link two roots with one comparison, and pop re-links the root's
+// children in two passes (pairwise left to right, then folded right to left),
+// O(log n) amortized. Nodes are allocated individually, so unlike the array heaps
+// a merge never moves items.
+template <typename T, typename Compare = std::less<T>>
+class PairingHeap {
+private:
+    struct Node {
+        T value;
+        Node* child;
+        Node* sibling;
+    };
+
+    Node* root = nullptr;
+    size_t count = 0;
+    Compare comp;
+
+    // the root that loses the comparison becomes the first child of the other
+    Node* link(Node* a, Node* b) {
+        if (comp(a->value, b->value)) std::swap(a, b);
+        b->sibling = a->child;
+        a->child = b;
+        return a;
+    }
+
+    Node* combine_children(Node* first) {
+        // first pass: link neighbours pairwise, building the results in reverse
+        Node* pairs = nullptr;
+        while (first) {
+            Node* a = first;
+            Node* b = a->sibling;
+            if (!b) {
+                a->sibling = pairs;
+                pairs = a;
+                break;
+            }
+            first = b->sibling;
+            a->sibling = b->sibling = nullptr;
+            Node* linked = link(a, b);
+            linked->sibling = pairs;
+            pairs = linked;
+        }
+        // second pass: fold from the last pair back to the first
+        Node* result = nullptr;
+        while (pairs) {
+            Node* next = pairs->sibling;
+            pairs->sibling = nullptr;
+            result = result ? link(result, pairs) : pairs;
+            pairs = next;
+        }
+        return result;
+    }
+
+    void insert(Node* node) {
+        root = root ? link(root, node) : node;
+        ++count;
+    }
+
+    void clear() {
+        Node* pending = root;
+        while (pending) {
+            Node* node = pending;
+            pending = node->sibling;
+            if (node->child) {
+                Node* tail = node->child;
+                while (tail->sibling) tail = tail->sibling;
+                tail->sibling = pending;
+                pending = node->child;
+            }
+            delete node;
+        }
+        root = nullptr;
+        count = 0;
+    }
+
+public:
+    using value_type = T;
+    using size_type = size_t;
+    using value_compare = Compare;
+
+    explicit PairingHeap(const Compare& compare = Compare()) : comp(compare) {}
+
+    PairingHeap(PairingHeap&& other) noexcept
+        : root(std::exchange(other.root, nullptr)), count(std::exchange(other.count, 0)), comp(other.comp) {}
+
+    PairingHeap& operator=(PairingHeap&& other) noexcept {
+        if (this != &other) {
+            clear();
+            root = std::exchange(other.root, nullptr);
+            count = std::exchange(other.count, 0);
+            comp = other.comp;
+        }
+        return *this;
+    }
+
+    PairingHeap(const PairingHeap&) = delete;
+    PairingHeap& operator=(const PairingHeap&) = delete;
+
+    ~PairingHeap() {
+        clear();
+    }
+
+    const T& top() const { return root->value; }
+    bool empty() const { return root == nullptr; }
+    size_t size() const { return count; }
+
+    void push(const T& value) {
+        insert(new Node{value, nullptr, nullptr});
+    }
+
+    void push(T&& value) {
+        insert(new Node{std::move(value), nullptr, nullptr});
+    }
+
+    template <typename... Args>
+    void emplace(Args&&... args) {
+        insert(new Node{T(std::forward<Args>(args)...), nullptr, nullptr});
+    }
+
+    void pop() {
+        Node* old = root;
+        root = combine_children(old->child);
+        --count;
+        delete old;
+    }
+
+    // take_top moves the top item out and removes it.
+    T take_top() {
+        T value = std::move(root->value);
+        pop();
+        return value;
+    }
+
+    // merge splices other's nodes into this heap in O(1), leaving other empty.
+    void merge(PairingHeap& other) {
+        if (this == &other || !other.root) return;
+        root = root ? link(root, other.root) : other.root;
+        count += other.count;
+        other.root = nullptr;
+        other.count = 0;
+    }
+};
+
+// Heap adapters used by ThreadSafePriorityQueue for operations the
+// std::priority_queue interface lacks: moving the top out, bulk insertion, and
+// merging two heaps. The generic versions work for any heap; the overloads below
+// are O(1) moves and O(n) heapify for std::priority_queue and DaryHeap, and an O(1)
+// splice for PairingHeap.
+template <typename Heap>
+typename Heap::value_type heap_take_top(Heap& heap) {
+    typename Heap::value_type value = heap.top();
+    heap.pop();
+    return value;
+}
+
+template <typename Heap, typename InputIt>
+void heap_push_range(Heap& heap, InputIt first, InputIt last) {
+    for (; first != last; ++first) heap.push(*first);
+}
+
+// moves every item of from into into, leaving from empty
+template <typename Heap>
+void heap_merge(Heap& into, Heap& from) {
+    while (!from.empty()) into.push(heap_take_top(from));
+}
+
+// reaches std::priority_queue's protected container and comparator
+template <typename T, typename Container, typename Compare>
+struct PriorityQueueAccess : std::priority_queue<T, Container, Compare> {
+    using Base = std::priority_queue<T, Container, Compare>;
+    static Container& container(Base& heap) { return heap.*(&PriorityQueueAccess::c); }
+    static Compare& compare(Base& heap) { return heap.*(&PriorityQueueAccess::comp); }
+};
+
+template <typename T, typename Container, typename Compare>
+T heap_take_top(std::priority_queue<T, Container, Compare>& heap) {
+    using Access = PriorityQueueAccess<T, Container, Compare>;
+    Container& c = Access::container(heap);
+    // pop_heap moves the top to the back, from where it can be moved out
+    std::pop_heap(c.begin(), c.end(), Access::compare(heap));
+    T value = std::move(c.back());
+    c.pop_back();
+    return value;
+}
+
+template <typename T, typename Container, typename Compare, typename InputIt>
+void heap_push_range(std::priority_queue<T, Container, Compare>& heap, InputIt first, InputIt last) {
+    using Access = PriorityQueueAccess<T, Container, Compare>;
+    Container& c = Access::container(heap);
+    size_t old_size = c.size();
+    c.insert(c.end(), first, last);
+    if (c.size() - old_size > old_size / 4) {
+        std::make_heap(c.begin(), c.end(), Access::compare(heap));
+    } else {
+        for (auto it = c.begin() + old_size; it != c.end();) std::push_heap(c.begin(), ++it, Access::compare(heap));
+    }
+}
+
+template <typename T, typename Container, typename Compare>
+void heap_merge(std::priority_queue<T, Container, Compare>& into, std::priority_queue<T, Container, Compare>& from) {
+    using Access = PriorityQueueAccess<T, Container, Compare>;
+    Container& c = Access::container(from);
+    heap_push_range(into, std::make_move_iterator(c.begin()), std::make_move_iterator(c.end()));
+    c.clear();
+}
+
+template <typename T, size_t D, typename Compare, typename Container>
+T heap_take_top(DaryHeap<T, D, Compare, Container>& heap) {
+    return heap.take_top();
+}
+
+template <typename T, size_t D, typename Compare, typename Container, typename InputIt>
+void heap_push_range(DaryHeap<T, D, Compare, Container>& heap, InputIt first, InputIt last) {
+    heap.push_range(first, last);
+}
+
+template <typename T, size_t D, typename Compare, typename Container>
+void heap_merge(DaryHeap<T, D, Compare, Container>& into, DaryHeap<T, D, Compare, Container>& from) {
+    into.merge(from);
+}
+
+template <typename T, typename Compare>
+T heap_take_top(PairingHeap<T, Compare>& heap) {
+    return heap.take_top();
+}
+
+template <typename T, typename Compare>
+void heap_merge(PairingHeap<T, Compare>& into, PairingHeap<T, Compare>& from) {
+    into.merge(from);
+}
+
+// Heap is the single-threaded priority queue being protected; any type with the
+// std::priority_queue push/top/pop/empty/size interface works. Choose the
+// comparator and container through it, e.g.
+//     ThreadSafePriorityQueue<T, std::priority_queue<T, std::deque<T>, std::greater<T>>>
+//     ThreadSafePriorityQueue<T, DaryHeap<T, 8, std::greater<T>>>
+//     ThreadSafePriorityQueue<T, PairingHeap<T>>    (O(1) merge_from)
+// Passing BoundedPriority<Lo, Hi> instead selects the bucket-queue specialization below.
+template <typename T, typename Heap = std::priority_queue<T>>
+class ThreadSafePriorityQueue {
+private:
+    Heap pq;
+    mutable std::mutex mtx;
+    std::condition_variable not_empty;
+    size_t waiters = 0; // threads blocked in wait_pop*, guarded by mtx
+    bool closed = false;
+
+    bool take(T& value) {
+        if (pq.empty()) return false;
+        value = heap_take_top(pq);
+        return true;
+    }
+
+    template <typename U>
+    bool insert(U&& value) {
+        bool wake;
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            if (closed) return false;
+            pq.push(std::forward<U>(value));
+            wake = waiters > 0;
+        }
+        // one new item, so wake exactly one waiter (and none if nobody waits)
+        if (wake) not_empty.notify_one();
+        return true;
+    }
+
+public:
+    ThreadSafePriorityQueue() = default;
+
+    // builds the heap from items in O(n) rather than n pushes
+    explicit ThreadSafePriorityQueue(std::vector<T> items) {
+        heap_push_range(pq, std::make_move_iterator(items.begin()), std::make_move_iterator(items.end()));
+    }
+
+    // push returns false if the queue was closed.
+    bool push(const T& value) {
+        return insert(value);
+    }
+
+    bool push(T&& value) {
+        return insert(std::move(value));
+    }
+
+    // push_bulk inserts a batch under a single lock acquisition, heapifying
+    // bottom-up when the batch is large relative to the queue.
+    // returns false (and inserts nothing) if the queue was closed.
+    template <typename InputIt>
+    bool push_bulk(InputIt first, InputIt last) {
+        bool wake;
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            if (closed) return false;
+            heap_push_range(pq, first, last);
+            wake = waiters > 0;
+        }
+        if (wake) not_empty.notify_all();
+        return true;
+    }
+
+    bool push_bulk(std::vector<T>&& items) {
+        bool ok = push_bulk(std::make_move_iterator(items.begin()), std::make_move_iterator(items.end()));
+        if (ok) items.clear();
+        return ok;
+    }
+
+    // merge_from moves every item of other into this queue, leaving other empty:
+    // O(1) for PairingHeap, O(n + m) heapify for the array heaps. Both locks are
+    // taken together with std::scoped_lock, so concurrent a.merge_from(b) and
+    // b.merge_from(a) cannot deadlock. returns false (and moves nothing) if this
+    // queue was closed.
+    bool merge_from(ThreadSafePriorityQueue&& other) {
+        if (&other == this) return true;
+        bool wake;
+        {
+            std::scoped_lock lock(mtx, other.mtx);
+            if (closed) return false;
+            heap_merge(pq, other.pq);
+            wake = waiters > 0;
+        }
+        if (wake) not_empty.notify_all();
+        return true;
+    }
+
+    bool pop(T& value) {
+        std::lock_guard<std::mutex> lock(mtx);
+        return take(value);
+    }
+
+    // wait_pop blocks until an item is available or the queue is closed.
+    // returns false if the queue is closed and no items remain.
+    bool wait_pop(T& value) {
+        std::unique_lock<std::mutex> lock(mtx);
+        ++waiters;
+        not_empty.wait(lock, [this] { return !pq.empty() || closed; });
+        --waiters;
+        return take(value);
+    }
+
+    // wait_pop_for additionally gives up after timeout; returns false on timeout.
+    template <typename Rep, typename Period>
+    bool wait_pop_for(T& value, const std::chrono::duration<Rep, Period>& timeout) {
+        std::unique_lock<std::mutex> lock(mtx);
+        ++waiters;
+        not_empty.wait_for(lock, timeout, [this] { return !pq.empty() || closed; });
+        --waiters;
+        return take(value);
+    }
+
+    // close rejects further pushes and wakes every waiter so remaining items can be drained.
+    void close() {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            closed = true;
+        }
+        not_empty.notify_all();
+    }
+
+    bool empty() const {
+        std::lock_guard<std::mutex> lock(mtx);
+        return pq.empty();
+    }
+
+    size_t size() const {
+        std::lock_guard<std::mutex> lock(mtx);
+        return pq.size();
+    }
+};
+
+// Maps an item to its integer priority; items are their own priority by default.
+struct IntegerPriority {
+    template <typename T>
+    int operator()(const T& value) const { return static_cast<int>(value); }
+};
+
+// Tag for priorities known at compile time to lie in [MinPriority, MaxPriority]:
+//     ThreadSafePriorityQueue<int, BoundedPriority<0, 99>>
+template <int MinPriority, int MaxPriority, typename PriorityOf = IntegerPriority>
+struct BoundedPriority {
+    static_assert(MinPriority <= MaxPriority, "empty priority range");
+};
+
+// Bucket-queue Priority Queue for bounded integer priorities.
+// One FIFO per priority level, each with its own lock, plus a bitmap of non-empty
+// levels. push appends to its level in O(1); pop finds the highest set bit with a
+// count-leading-zeros instruction and takes from that level. Items of equal
+// priority come out in FIFO order. Priorities outside the range are clamped.
+template <typename T, int MinPriority, int MaxPriority, typename PriorityOf>
+class ThreadSafePriorityQueue<T, BoundedPriority<MinPriority, MaxPriority, PriorityOf>> {
+private:
+    static constexpr size_t LEVELS = static_cast<size_t>(MaxPriority - MinPriority) + 1;
+    static constexpr size_t WORDS = (LEVELS + 63) / 64;
+
+    struct alignas(64) Bucket {
+        std::mutex mtx;
+        std::deque<T> items;
+    };
+
+    std::unique_ptr<Bucket[]> buckets;
+    std::atomic<uint64_t> non_empty[WORDS] = {}; // bit b set iff bucket b has items; updated under b's lock
+    alignas(64) std::atomic<size_t> count{0};
+
+    // blocking pops park here; pushes only touch it when someone is waiting
+    alignas(64) std::mutex wait_mtx;
+    std::condition_variable not_empty_cv;
+    std::atomic<size_t> waiters{0};
+    std::atomic<bool> closed{false};
+
+    // true if some bucket's bit is set. The bitmap update in push and waiters are
+    // seq_cst, so a push either sees the waiter or the waiter's predicate (checked
+    // under wait_mtx) sees the bit. Waiting on the bitmap rather than on count means
+    // a waiter does not wake up before the item is actually in its bucket.
+    bool any_ready() const {
+        for (size_t w = 0; w < WORDS; ++w) {
+            if (non_empty[w].load()) return true;
+        }
+        return false;
+    }
+
+    template <typename Wait>
+    bool blocking_pop(T& value, Wait wait) {
+        while (true) {
+            if (pop(value)) return true;
+            if (closed.load()) {
+                if (count.load() == 0) return false;
+                // a push that got past the closed check is still appending its item
+                std::this_thread::yield();
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(wait_mtx);
+            ++waiters;
+            bool ready = wait(lock, [this] { return any_ready() || closed.load(); });
+            --waiters;
+            if (!ready) return pop(value); // timed out
+        }
+    }
+
+    static size_t level_of(const T& value) {
+        int priority = std::clamp(PriorityOf()(value), MinPriority, MaxPriority);
+        return static_cast<size_t>(priority - MinPriority);
+    }
+
+    // highest non-empty level, or LEVELS if the bitmap is clear
+    size_t highest_level() const {
+        for (size_t w = WORDS; w-- > 0;) {
+            uint64_t bits = non_empty[w].load(std::memory_order_acquire);
+            if (bits) return w * 64 + (63 - static_cast<size_t>(__builtin_clzll(bits)));
+        }
+        return LEVELS;
+    }
+
+public:
+    ThreadSafePriorityQueue() : buckets(new Bucket[LEVELS]) {}
+
+    // push returns false if the queue was closed.
+    bool push(const T& value) {
+        return push(T(value));
+    }
+
+    bool push(T&& value) {
+        // count first: a closing consumer that sees count == 0 then cannot miss this item
+        count.fetch_add(1);
+        if (closed.load()) {
+            count.fetch_sub(1);
+            return false;
+        }
+        size_t level = level_of(value);
+        Bucket& bucket = buckets[level];
+        {
+            std::lock_guard<std::mutex> lock(bucket.mtx);
+            bucket.items.push_back(std::move(value));
+            if (bucket.items.size() == 1) {
+                non_empty[level / 64].fetch_or(uint64_t(1) << (level % 64)); // seq_cst, see any_ready
+            }
+        }
+        if (waiters.load() > 0) {
+            // pass through the waiters' mutex so a waiter cannot miss the notify
+            { std::lock_guard<std::mutex> lock(wait_mtx); }
+            not_empty_cv.notify_one();
+        }
+        return true;
+    }
+
+    bool pop(T& value) {
+        while (true) {
+            size_t level = highest_level();
+            if (level == LEVELS) return false;
+            Bucket& bucket = buckets[level];
+            std::lock_guard<std::mutex> lock(bucket.mtx);
+            if (bucket.items.empty()) continue; // drained by another popper; look again
+            value = std::move(bucket.items.front());
+            bucket.items.pop_front();
+            if (bucket.items.empty()) {
+                non_empty[level / 64].fetch_and(~(uint64_t(1) << (level % 64)), std::memory_order_release);
+            }
+            count.fetch_sub(1);
+            return true;
+        }
+    }
+
+    // wait_pop blocks until an item is available or the queue is closed.
+    // returns false if the queue is closed and no items remain.
+    bool wait_pop(T& value) {
+        return blocking_pop(value, [this](std::unique_lock<std::mutex>& lock, auto pred) {
+            not_empty_cv.wait(lock, pred);
+            return true;
+        });
+    }
+
+    // wait_pop_for additionally gives up after timeout; returns false on timeout.
+    template <typename Rep, typename Period>
+    bool wait_pop_for(T& value, const std::chrono::duration<Rep, Period>& timeout) {
+        auto deadline = std::chrono::steady_clock::now() + timeout;
+        return blocking_pop(value, [this, deadline](std::unique_lock<std::mutex>& lock, auto pred) {
+            return not_empty_cv.wait_until(lock, deadline, pred);
+        });
+    }
+
+    // close rejects further pushes and wakes every waiter so remaining items can be drained.
+    void close() {
+        {
+            std::lock_guard<std::mutex> lock(wait_mtx);
+            closed.store(true);
+        }
+        not_empty_cv.notify_all();
+    }
+
+    bool empty() const {
+        return count.load(std::memory_order_relaxed) == 0;
+    }
+
+    size_t size() const {
+        return count.load(std::memory_order_relaxed);
+    }
+};
+
+// Binary max-heap (with respect to Compare) whose items can be addressed after
+// insertion. push returns a Handle that stays valid until its item is removed;
+// update/modify re-position the item in O(log n) and erase removes it outright, so
+// the heap never holds duplicates or tombstones. A handle whose item is gone is
+// detected through its generation count and makes update/modify/erase return false.
+template <typename T, typename Compare = std::less<T>>
+class IndexedHeap {
+public:
+    struct Handle {
+        uint32_t slot = 0;
+        uint32_t generation = 0;
+    };
+
+private:
+    static constexpr size_t NOT_QUEUED = ~size_t(0);
+
+    struct Entry {
+        T value;
+        uint32_t slot;
+    };
+
+    struct Slot {
+        size_t heap_index = NOT_QUEUED;
+        uint32_t generation = 0;
+    };
+
+    std::vector<Entry> heap;
+    std::vector<Slot> slots;
+    std::vector<uint32_t> free_slots;
+    Compare comp;
+
+    void place(size_t i, Entry&& entry) {
+        slots[entry.slot].heap_index = i;
+        heap[i] = std::move(entry);
+    }
+
+    void sift_up(size_t i) {
+        Entry entry = std::move(heap[i]);
+        while (i > 0) {
+            size_t parent = (i - 1) / 2;
+            if (!comp(heap[parent].value, entry.value)) break;
+            place(i, std::move(heap[parent]));
+            i = parent;
+        }
+        place(i, std::move(entry));
+    }
+
+    void sift_down(size_t i) {
+        const size_t n = heap.size();
+        Entry entry = std::move(heap[i]);
+        while (true) {
+            size_t child = 2 * i + 1;
+            if (child >= n) break;
+            if (child + 1 < n && comp(heap[child].value, heap[child + 1].value)) ++child;
+            if (!comp(entry.value, heap[child].value)) break;
+            place(i, std::move(heap[child]));
+            i = child;
+        }
+        place(i, std::move(entry));
+    }
+
+    // moves heap[i] to where it belongs after its value changed
+    void restore(size_t i) {
+        uint32_t slot = heap[i].slot;
+        sift_up(i);
+        sift_down(slots[slot].heap_index);
+    }
+
+    // removes heap[i], filling the hole with the last entry; returns the removed value
+    T remove_at(size_t i) {
+        uint32_t slot = heap[i].slot;
+        T value = std::move(heap[i].value);
+        slots[slot].heap_index = NOT_QUEUED;
+        ++slots[slot].generation;
+        free_slots.push_back(slot);
+
+        Entry last = std::move(heap.back());
+        heap.pop_back();
+        if (i < heap.size()) {
+            place(i, std::move(last));
+            restore(i);
+        }
+        return value;
+    }
+
+public:
+    using value_type = T;
+
+    explicit IndexedHeap(const Compare& compare = Compare()) : comp(compare) {}
+
+    Handle push(T value) {
+        uint32_t slot;
+        if (free_slots.empty()) {
+            slot = static_cast<uint32_t>(slots.size());
+            slots.emplace_back();
+        } else {
+            slot = free_slots.back();
+            free_slots.pop_back();
+        }
+        heap.push_back(Entry{std::move(value), slot});
+        slots[slot].heap_index = heap.size() - 1;
+        sift_up(heap.size() - 1);
+        return Handle{slot, slots[slot].generation};
+    }
+
+    const T& top() const { return heap.front().value; }
+    T take_top() { return remove_at(0); }
+
+    bool contains(const Handle& handle) const {
+        return handle.slot < slots.size() && slots[handle.slot].generation == handle.generation &&
+               slots[handle.slot].heap_index != NOT_QUEUED;
+    }
+
+    bool update(const Handle& handle, T value) {
+        return modify(handle, [&value](T& item) { item = std::move(value); });
+    }
+
+    // modify applies f to the item in place and restores heap order.
+    template <typename F>
+    bool modify(const Handle& handle, F f) {
+        if (!contains(handle)) return false;
+        size_t i = slots[handle.slot].heap_index;
+        f(heap[i].value);
+        restore(i);
+        return true;
+    }
+
+    bool erase(const Handle& handle) {
+        if (!contains(handle)) return false;
+        remove_at(slots[handle.slot].heap_index);
+        return true;
+    }
+
+    bool empty() const { return heap.empty(); }
+    size_t size() const { return heap.size(); }
+};
+
+// Indexed Priority Queue with update/erase handles; IndexedHeap behind one mutex.
+template <typename T, typename Compare = std::less<T>>
+class ThreadSafeIndexedPriorityQueue {
+public:
+    using Handle = typename IndexedHeap<T, Compare>::Handle;
+
+private:
+    IndexedHeap<T, Compare> heap;
+    mutable std::mutex mtx;
+
+public:
+    ThreadSafeIndexedPriorityQueue() = default;
+
+    Handle push(T value) {
+        std::lock_guard<std::mutex> lock(mtx);
+        return heap.push(std::move(value));
+    }
+
+    bool pop(T& value) {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (heap.empty()) return false;
+        value = heap.take_top();
+        return true;
+    }
+
+    // update replaces the item behind handle and restores heap order.
+    // returns false if the item was already popped or erased.
+    bool update(const Handle& handle, T value) {
+        std::lock_guard<std::mutex> lock(mtx);
+        return heap.update(handle, std::move(value));
+    }
+
+    // erase removes the item behind handle; returns false if it is already gone.
+    bool erase(const Handle& handle) {
+        std::lock_guard<std::mutex> lock(mtx);
+        return heap.erase(handle);
+    }
+
+    bool contains(const Handle& handle) const {
+        std::lock_guard<std::mutex> lock(mtx);
+        return heap.contains(handle);
+    }
+
+    bool empty() const {
+        std::lock_guard<std::mutex> lock(mtx);
+        return heap.empty();
+    }
+
+    size_t size() const {
+        std::lock_guard<std::mutex> lock(mtx);
+        return heap.size();
+    }
+};
+
+// Timer backends for DelayQueue. Both provide
+//     Handle schedule(T value, time_point deadline)
+//     bool cancel(Handle) / bool rearm(Handle, time_point)
+//     bool pop_expired(time_point now, T& value)
+//     std::optional<time_point> next_wakeup(time_point now)
+//     empty() / size()
+// and are used under DelayQueue's lock.
+
+// Deadline-ordered IndexedHeap: O(log n) schedule/cancel/rearm, exact deadlines.
+template <typename T>
+class HeapTimers {
+public:
+    using Clock = std::chrono::steady_clock;
+
+private:
+    struct Timer {
+        Clock::time_point deadline;
+        uint64_t seq; // FIFO among equal deadlines
+        T value;
+    };
+
+    // earliest deadline is the heap's "largest" item
+    struct LaterDeadline {
+        bool operator()(const Timer& a, const Timer& b) const {
+            return a.deadline != b.deadline ? b.deadline < a.deadline : b.seq < a.seq;
+        }
+    };
+
+    IndexedHeap<Timer, LaterDeadline> heap;
+    uint64_t next_seq = 0;
+
+public:
+    using Handle = typename IndexedHeap<Timer, LaterDeadline>::Handle;
+
+    Handle schedule(T value, Clock::time_point deadline) {
+        return heap.push(Timer{deadline, next_seq++, std::move(value)});
+    }
+
+    bool cancel(const Handle& handle) {
+        return heap.erase(handle);
+    }
+
+    bool rearm(const Handle& handle, Clock::time_point deadline) {
+        uint64_t seq = next_seq++;
+        return heap.modify(handle, [deadline, seq](Timer& timer) {
+            timer.deadline = deadline;
+            timer.seq = seq;
+        });
+    }
+
+    bool pop_expired(Clock::time_point now, T& value) {
+        if (heap.empty() || now < heap.top().deadline) return false;
+        value = std::move(heap.take_top().value);
+        return true;
+    }
+
+    std::optional<Clock::time_point> next_wakeup(Clock::time_point) const {
+        if (heap.empty()) return std::nullopt;
+        return heap.top().deadline;
+    }
+
+    bool empty() const { return heap.empty(); }
+    size_t size() const { return heap.size(); }
+};
+
+// Hierarchical timing wheel (Varghese-Lauck): LEVELS wheels of 256 slots, a level-l
+// slot covering 256^l ticks. A timer goes into the lowest wheel whose span covers its
+// distance from now, in O(1); every slot is an intrusive doubly-linked list, so cancel
+// and rearm are O(1) too. Whenever a lower wheel wraps, the matching slot of the next
+// wheel is cascaded down. Deadlines are rounded up to whole ticks, so a timer never
+// fires early and fires at most one tick late.
+template <typename T>
+class TimingWheelTimers {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Handle {
+        uint32_t slot = 0;
+        uint32_t generation = 0;
+    };
+
+private:
+    static constexpr int LEVELS = 4;
+    static constexpr int SLOT_BITS = 8;
+    static constexpr uint32_t SLOTS = 1u << SLOT_BITS;
+    static constexpr uint32_t NIL = ~uint32_t(0);
+    static constexpr uint32_t READY = LEVELS * SLOTS; // list id of the expired list
+    static constexpr uint32_t FREE = READY + 1;
+
+    struct Entry {
+        std::optional<T> value;
+        uint64_t expiry = 0; // tick
+        uint32_t prev = NIL, next = NIL;
+        uint32_t list = FREE;
+        uint32_t generation = 0;
+    };
+
+    struct List {
+        uint32_t head = NIL, tail = NIL;
+    };
+
+    std::vector<Entry> entries;
+    std::vector<uint32_t> free_entries;
+    List lists[LEVELS * SLOTS + 1]; // wheel slots, then READY
+    Clock::time_point start;
+    Clock::duration resolution;
+    uint64_t current = 0;    // last processed tick
+    size_t count = 0;        // live timers
+    size_t in_wheels = 0;    // live timers not yet on the READY list
+
+    // deadlines round up, the clock rounds down: a timer is due once now reaches it
+    uint64_t deadline_tick(Clock::time_point t) const {
+        if (t <= start) return 0;
+        return static_cast<uint64_t>((t - start + resolution - Clock::duration(1)) / resolution);
+    }
+
+    uint64_t now_tick(Clock::time_point t) const {
+        if (t <= start) return 0;
+        return static_cast<uint64_t>((t - start) / resolution);
+    }
+
+    void link(uint32_t id, uint32_t list_id) {
+        Entry& e = entries[id];
+        List& list = lists[list_id];
+        e.list = list_id;
+        e.next = NIL;
+        e.prev = list.tail;
+        if (list.tail != NIL) entries[list.tail].next = id;
+        else list.head = id;
+        list.tail = id;
+        if (list_id != READY) ++in_wheels;
+    }
+
+    void unlink(uint32_t id) {
+        Entry& e = entries[id];
+        List& list = lists[e.list];
+        if (e.prev != NIL) entries[e.prev].next = e.next;
+        else list.head = e.next;
+        if (e.next != NIL) entries[e.next].prev = e.prev;
+        else list.tail = e.prev;
+        e.prev = e.next = NIL;
+        if (e.list != READY) --in_wheels;
+    }
+
+    void place(uint32_t id) {
+        uint64_t expiry = entries[id].expiry;
+        if (expiry <= current) {
+            link(id, READY);
+            return;
+        }
+        uint64_t delta = expiry - current;
+        int level = 0;
+        while (level < LEVELS - 1 && delta >= (uint64_t(1) << (SLOT_BITS * (level + 1)))) ++level;
+        if (delta >= (uint64_t(1) << (SLOT_BITS * LEVELS))) {
+            // beyond the top wheel: park in its farthest slot; re-placed when that cascades
+            expiry = current + (uint64_t(1) << (SLOT_BITS * LEVELS)) - 1;
+        }
+        uint32_t slot = static_cast<uint32_t>((expiry >> (SLOT_BITS * level)) & (SLOTS - 1));
+        link(id, level * SLOTS + slot);
+    }
+
+    // detaches a whole slot list and re-places each of its timers
+    void replace_all(uint32_t list_id) {
+        uint32_t id = lists[list_id].head;
+        while (id != NIL) {
+            uint32_t next = entries[id].next;
+            unlink(id);
+            place(id);
+            id = next;
+        }
+    }
+
+    // ticks until the level-0 wheel next holds something, capped at its next wrap
+    uint64_t ticks_to_next_event() const {
+        uint64_t to_wrap = SLOTS - (current & (SLOTS - 1));
+        for (uint64_t d = 1; d < to_wrap; ++d) {
+            if (lists[(current + d) & (SLOTS - 1)].head != NIL) return d;
+        }
+        return to_wrap;
+    }
+
+    void advance(uint64_t target) {
+        if (in_wheels == 0) {
+            current = std::max(current, target);
+            return;
+        }
+        while (current < target) {
+            current += std::min(ticks_to_next_event(), target - current);
+            if ((current & (SLOTS - 1)) == 0) {
+                for (int level = 1; level < LEVELS; ++level) {
+                    replace_all(level * SLOTS + static_cast<uint32_t>((current >> (SLOT_BITS * level)) & (SLOTS - 1)));
+                    if (((current >> (SLOT_BITS * level)) & (SLOTS - 1)) != 0) break;
+                }
+            }
+            replace_all(static_cast<uint32_t>(current & (SLOTS - 1)));
+        }
+    }
+
+    void release(uint32_t id) {
+        Entry& e = entries[id];
+        e.value.reset();
+        e.list = FREE;
+        ++e.generation;
+        free_entries.push_back(id);
+        --count;
+    }
+
+    bool valid(const Handle& handle) const {
+        return handle.slot < entries.size() && entries[handle.slot].generation == handle.generation &&
+               entries[handle.slot].list != FREE;
+    }
+
+public:
+    explicit TimingWheelTimers(Clock::duration tick = std::chrono::milliseconds(1))
+        : start(Clock::now()), resolution(tick) {}
+
+    Handle schedule(T value, Clock::time_point deadline) {
+        uint32_t id;
+        if (free_entries.empty()) {
+            id = static_cast<uint32_t>(entries.size());
+            entries.emplace_back();
+        } else {
+            id = free_entries.back();
+            free_entries.pop_back();
+        }
+        entries[id].value.emplace(std::move(value));
+        entries[id].expiry = deadline_tick(deadline);
+        place(id);
+        ++count;
+        return Handle{id, entries[id].generation};
+    }
+
+    bool cancel(const Handle& handle) {
+        if (!valid(handle)) return false;
+        unlink(handle.slot);
+        release(handle.slot);
+        return true;
+    }
+
+    bool rearm(const Handle& handle, Clock::time_point deadline) {
+        if (!valid(handle)) return false;
+        unlink(handle.slot);
+        entries[handle.slot].expiry = deadline_tick(deadline);
+        place(handle.slot);
+        return true;
+    }
+
+    bool pop_expired(Clock::time_point now, T& value) {
+        advance(now_tick(now));
+        uint32_t id = lists[READY].head;
+        if (id == NIL) return false;
+        unlink(id);
+        value = std::move(*entries[id].value);
+        release(id);
+        return true;
+    }
+
+    std::optional<Clock::time_point> next_wakeup(Clock::time_point now) const {
+        if (count == 0) return std::nullopt;
+        if (lists[READY].head != NIL) return now;
+        return start + resolution * static_cast<Clock::rep>(current + ticks_to_next_event());
+    }
+
+    bool empty() const { return count == 0; }
+    size_t size() const { return count; }
+};
+
+// Delay Queue: items become poppable once their deadline has passed.
+// pop blocks until the earliest deadline expires (or the queue is closed);
+// schedule returns a handle for cancel and rearm. Backend is HeapTimers (exact,
+// O(log n)) or TimingWheelTimers (O(1) schedule/cancel for very large populations).
+template <typename T, typename Backend = HeapTimers<T>>
+class DelayQueue {
+public:
+    using Clock = std::chrono::steady_clock;
+    using Handle = typename Backend::Handle;
+
+private:
+    Backend timers;
+    std::mutex mtx;
+    std::condition_variable wakeup;
+    size_t waiters = 0;
+    bool closed = false;
+
+    // what a sleeper is waiting towards; only computed when someone sleeps, since
+    // next_wakeup may scan (TimingWheelTimers) and keeps schedule off the O(1) path
+    std::optional<Clock::time_point> sleeper_deadline() {
+        if (waiters == 0) return std::nullopt;
+        return timers.next_wakeup(Clock::now());
+    }
+
+    // wake a sleeper if this deadline is earlier than what it is sleeping towards
+    void notify_if_earlier(std::unique_lock<std::mutex>& lock, const std::optional<Clock::time_point>& before,
+                           Clock::time_point deadline) {
+        bool wake = waiters > 0 && (!before || deadline < *before);
+        lock.unlock();
+        if (wake) wakeup.notify_one();
+    }
+
+public:
+    DelayQueue() = default;
+    explicit DelayQueue(Backend backend) : timers(std::move(backend)) {}
+
+    Handle schedule(T value, Clock::time_point deadline) {
+        std::unique_lock<std::mutex> lock(mtx);
+        auto before = sleeper_deadline();
+        Handle handle = timers.schedule(std::move(value), deadline);
+        notify_if_earlier(lock, before, deadline);
+        return handle;
+    }
+
+    Handle schedule_after(T value, Clock::duration delay) {
+        return schedule(std::move(value), Clock::now() + delay);
+    }
+
+    // cancel drops a pending item; returns false if it already fired or was cancelled.
+    bool cancel(const Handle& handle) {
+        std::lock_guard<std::mutex> lock(mtx);
+        return timers.cancel(handle);
+    }
+
+    // rearm moves a pending item to a new deadline; returns false if it is gone.
+    bool rearm(const Handle& handle, Clock::time_point deadline) {
+        std::unique_lock<std::mutex> lock(mtx);
+        auto before = sleeper_deadline();
+        if (!timers.rearm(handle, deadline)) return false;
+        notify_if_earlier(lock, before, deadline);
+        return true;
+    }
+
+    // pop blocks until an item's deadline passes or the queue is closed.
+    // Once closed, items that have already expired are still delivered; pop returns
+    // false when none are left instead of waiting for later deadlines. Those items
+    // stay queued (size, cancel and rearm still see them) and are handed out by any
+    // pop or try_pop that runs after their deadline has passed.
+    bool pop(T& value) {
+        std::unique_lock<std::mutex> lock(mtx);
+        while (true) {
+            auto now = Clock::now();
+            if (timers.pop_expired(now, value)) return true;
+            if (closed) return false;
+            auto next = timers.next_wakeup(now);
+            ++waiters;
+            if (next) wakeup.wait_until(lock, *next);
+            else wakeup.wait(lock);
+            --waiters;
+        }
+    }
+
+    // try_pop returns an already-expired item without blocking.
+    bool try_pop(T& value) {
+        std::lock_guard<std::mutex> lock(mtx);
+        return timers.pop_expired(Clock::now(), value);
+    }
+
+    void close() {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            closed = true;
+        }
+        wakeup.notify_all();
+    }
+
+    bool empty() {
+        std::lock_guard<std::mutex> lock(mtx);
+        return timers.empty();
+    }
+
+    size_t size() {
+        std::lock_guard<std::mutex> lock(mtx);
+        return timers.size();
+    }
+};
+
+// Priority Executor: a fixed pool of workers running tasks from a
+// ThreadSafePriorityQueue. Priorities are 0 (lowest) .. priorities - 1, and aging is
+// built into the key rather than done by rescanning the queue: a task is ordered by
+//     key = enqueue time + (priorities - 1 - priority) * aging_step
+// smallest first. Keys never change after push, so aging costs nothing, yet a task
+// that has waited (p - q) * aging_step outranks every priority-p task submitted after
+// it: no class can be starved for longer than that. Per-priority queueing delay
+// (submit to start of run) is recorded in a log2 histogram.
+class PriorityExecutor {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct DelayStats {
+        uint64_t count = 0;
+        Clock::duration mean{0};
+        Clock::duration p99{0}; // upper bound of the log2 bucket holding the 99th percentile
+        Clock::duration max{0};
+    };
+
+private:
+    struct Task {
+        Clock::duration key;
+        uint64_t seq; // FIFO among equal keys
+        int priority;
+        Clock::time_point enqueued;
+        std::function<void()> work;
+    };
+
+    // std::priority_queue pops the largest item: make that the smallest key
+    struct LaterKey {
+        bool operator()(const Task& a, const Task& b) const {
+            return a.key != b.key ? b.key < a.key : b.seq < a.seq;
+        }
+    };
+
+    struct ClassStats {
+        static constexpr int BUCKETS = 64; // bucket k counts delays in [2^(k-1), 2^k) ns
+        std::atomic<uint64_t> count{0};
+        std::atomic<uint64_t> total_ns{0};
+        std::atomic<uint64_t> max_ns{0};
+        std::atomic<uint64_t> histogram[BUCKETS] = {};
+    };
+
+    ThreadSafePriorityQueue<Task, std::priority_queue<Task, std::vector<Task>, LaterKey>> tasks;
+    std::vector<ClassStats> stats;
+    std::vector<std::thread> workers;
+    std::atomic<uint64_t> next_seq{0};
+    const int priorities;
+    const Clock::duration aging_step;
+    const Clock::time_point start;
+
+    void record(int priority, Clock::duration delay) {
+        ClassStats& cs = stats[priority];
+        uint64_t ns = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(delay).count());
+        cs.count.fetch_add(1, std::memory_order_relaxed);
+        cs.total_ns.fetch_add(ns, std::memory_order_relaxed);
+        uint64_t seen = cs.max_ns.load(std::memory_order_relaxed);
+        while (ns > seen && !cs.max_ns.compare_exchange_weak(seen, ns, std::memory_order_relaxed)) {
+        }
+        int bucket = ns == 0 ? 0 : 64 - __builtin_clzll(ns);
+        cs.histogram[std::min(bucket, ClassStats::BUCKETS - 1)].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void run() {
+        Task task;
+        while (tasks.wait_pop(task)) {
+            record(task.priority, Clock::now() - task.enqueued);
+            task.work();
+        }
+    }
+
+    // pins worker i to core i modulo the core count; a no-op off Linux
+    static void pin(std::thread& worker, size_t i) {
+#ifdef __linux__
+        unsigned cores = std::thread::hardware_concurrency();
+        if (cores == 0) return;
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(i % cores, &set);
+        pthread_setaffinity_np(worker.native_handle(), sizeof(set), &set);
+#else
+        (void)worker;
+        (void)i;
+#endif
+    }
+
+public:
+    explicit PriorityExecutor(size_t num_workers, int num_priorities = 8,
+                              Clock::duration step = std::chrono::milliseconds(1), bool pin_workers = true)
+        : stats(num_priorities), priorities(num_priorities), aging_step(step), start(Clock::now()) {
+        for (size_t i = 0; i < num_workers; ++i) {
+            workers.emplace_back(&PriorityExecutor::run, this);
+            if (pin_workers) pin(workers.back(), i);
+        }
+    }
+
+    ~PriorityExecutor() {
+        shutdown();
+    }
+
+    PriorityExecutor(const PriorityExecutor&) = delete;
+    PriorityExecutor& operator=(const PriorityExecutor&) = delete;
+
+    // submit returns false after shutdown. Out-of-range priorities are clamped.
+    template <typename F>
+    bool submit(int priority, F&& work) {
+        priority = std::max(0, std::min(priority, priorities - 1));
+        auto now = Clock::now();
+        Task task{(now - start) + aging_step * (priorities - 1 - priority),
+                  next_seq.fetch_add(1, std::memory_order_relaxed), priority, now,
+                  std::function<void()>(std::forward<F>(work))};
+        return tasks.push(std::move(task));
+    }
+
+    // shutdown stops accepting tasks, runs those already queued, and joins the workers.
+    void shutdown() {
+        tasks.close();
+        for (auto& worker : workers) {
+            if (worker.joinable()) worker.join();
+        }
+    }
 
+    DelayStats delay_stats(int priority) const {
+        DelayStats result;
+        if (priority < 0 || priority >= priorities) return result;
+        const ClassStats& cs = stats[priority];
+        result.count = cs.count.load(std::memory_order_relaxed);
+        if (result.count == 0) return result;
+        result.mean = std::chrono::nanoseconds(cs.total_ns.load(std::memory_order_relaxed) / result.count);
+        result.max = std::chrono::nanoseconds(cs.max_ns.load(std::memory_order_relaxed));
+        uint64_t target = result.count - result.count / 100, seen = 0;
+        for (int bucket = 0; bucket < ClassStats::BUCKETS; ++bucket) {
+            seen += cs.histogram[bucket].load(std::memory_order_relaxed);
+            if (seen >= target) {
+                Clock::duration bound = std::chrono::nanoseconds(bucket == 0 ? 0 : (uint64_t(1) << bucket) - 1);
+                result.p99 = std::min(bound, result.max);
+                break;
+            }
+        }
+        return result;
+    }
+};
+
+// MultiQueue relaxed Priority Queue.
+// c * threads independent heap shards, each with its own lock. push goes to a
+// random shard; pop samples two random shards, compares their tops under both
+// locks and pops the better one. Shard locks are only ever try-locked, so a thread
+// never waits behind another: on contention it just samples again. pop returns an
+// item close to, but not necessarily, the overall maximum (expected rank error is
+// O(shards)).
 template <typename T>
-class ThreadSafePriorityQueue {
+class MultiQueuePriorityQueue {
 private:
-    std::priority_queue<T> pq;
-    mutable std::mutex mtx;
+    struct alignas(64) Shard {
+        std::mutex mtx;
+        std::priority_queue<T> heap;
+    };
+
+    std::vector<std::unique_ptr<Shard>> shards;
+    alignas(64) std::atomic<size_t> count{0};
+
+    static size_t random_index(size_t n) {
+        static thread_local std::minstd_rand gen(std::random_device{}());
+        return gen() % n;
+    }
 
 public:
-    ThreadSafePriorityQueue() = default;
+    explicit MultiQueuePriorityQueue(size_t num_threads = std::thread::hardware_concurrency(),
+                                     size_t shards_per_thread = 2) {
+        size_t n = std::max<size_t>(2, num_threads * shards_per_thread);
+        for (size_t i = 0; i < n; ++i) shards.push_back(std::make_unique<Shard>());
+    }
 
     void push(const T& value) {
-        std::lock_guard<std::mutex> lock(mtx);
-        pq.push(value);
+        push(T(value));
     }
 
     void push(T&& value) {
-        std::lock_guard<std::mutex> lock(mtx);
-        pq.push(std::move(value));
+        count.fetch_add(1, std::memory_order_relaxed);
+        while (true) {
+            Shard& shard = *shards[random_index(shards.size())];
+            std::unique_lock<std::mutex> lock(shard.mtx, std::try_to_lock);
+            if (lock.owns_lock()) {
+                shard.heap.push(std::move(value));
+                return;
+            }
+            // a failed try-lock means the holder may be descheduled: give up the CPU
+            // before sampling again instead of spinning out the timeslice
+            std::this_thread::yield();
+        }
     }
 
+    // returns false once no items remain in any shard.
     bool pop(T& value) {
-        std::lock_guard<std::mutex> lock(mtx);
-        if (pq.empty()) return false;
-        value = pq.top();
-        pq.pop();
+        const size_t n = shards.size();
+        while (count.load(std::memory_order_relaxed) > 0) {
+            size_t i = random_index(n);
+            size_t j = random_index(n - 1);
+            if (j >= i) ++j;
+
+            // both tops are compared in place while their shards are held, so no
+            // payload is copied and the chosen top cannot be taken in between
+            {
+                Shard& a = *shards[i];
+                Shard& b = *shards[j];
+                std::unique_lock<std::mutex> lock_a(a.mtx, std::try_to_lock);
+                std::unique_lock<std::mutex> lock_b(b.mtx, std::try_to_lock);
+                bool has_a = lock_a.owns_lock() && !a.heap.empty();
+                bool has_b = lock_b.owns_lock() && !b.heap.empty();
+                if (has_a || has_b) {
+                    Shard& best = (has_a && (!has_b || !(a.heap.top() < b.heap.top()))) ? a : b;
+                    value = heap_take_top(best.heap);
+                    count.fetch_sub(1, std::memory_order_relaxed);
+                    return true;
+                }
+            }
+            // failed round: both samples empty or locked
+            std::this_thread::yield();
+        }
+        return false;
+    }
+
+    bool empty() const {
+        return count.load(std::memory_order_relaxed) == 0;
+    }
+
+    size_t size() const {
+        return count.load(std::memory_order_relaxed);
+    }
+};
+
+// Flat-combining Priority Queue.
+// Instead of every thread taking the lock to sift the heap itself, a thread posts
+// its request to a publication slot and then either becomes the combiner (if the
+// combiner lock is free) or waits. The combiner applies every pending request in one
+// pass on a heap that stays hot in its cache: pops are served from the larger of the
+// heap top and the pending pushes (eliminating push/pop pairs without touching the
+// heap), and leftover pushes are heapified in bulk. Each pass linearizes as all of
+// its pushes followed by all of its pops.
+template <typename T>
+class FlatCombiningPriorityQueue {
+private:
+    static constexpr size_t MAX_SLOTS = 128;
+
+    enum Request : int { IDLE, PUSH, POP, DONE };
+
+    struct alignas(64) Slot {
+        std::atomic<bool> owned{false};
+        std::atomic<int> request{IDLE};
+        std::optional<T> value; // push argument in, pop result out
+    };
+
+    Slot slots[MAX_SLOTS];
+    alignas(64) std::mutex combiner;
+    std::vector<T> heap; // guarded by combiner
+    std::vector<Slot*> pushes, pops; // combiner scratch, reused across passes
+    std::atomic<size_t> count{0};
+
+    Slot& claim_slot() {
+        size_t start = std::hash<std::thread::id>()(std::this_thread::get_id()) % MAX_SLOTS;
+        while (true) {
+            for (size_t i = 0; i < MAX_SLOTS; ++i) {
+                Slot& slot = slots[(start + i) % MAX_SLOTS];
+                bool expected = false;
+                if (!slot.owned.load(std::memory_order_relaxed) &&
+                    slot.owned.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+                    return slot;
+                }
+            }
+            std::this_thread::yield();
+        }
+    }
+
+    void combine() {
+        pushes.clear();
+        pops.clear();
+        for (auto& slot : slots) {
+            int request = slot.request.load(std::memory_order_acquire);
+            if (request == PUSH) pushes.push_back(&slot);
+            else if (request == POP) pops.push_back(&slot);
+        }
+        if (pushes.empty() && pops.empty()) return;
+
+        // largest pending push first so pops can take them without entering the heap
+        std::sort(pushes.begin(), pushes.end(), [](Slot* a, Slot* b) { return *b->value < *a->value; });
+        size_t next_push = 0;
+        for (Slot* slot : pops) {
+            bool from_push = next_push < pushes.size() &&
+                             (heap.empty() || !(*pushes[next_push]->value < heap.front()));
+            if (from_push) {
+                slot->value = std::move(pushes[next_push]->value);
+                pushes[next_push]->value.reset();
+                ++next_push;
+            } else if (!heap.empty()) {
+                std::pop_heap(heap.begin(), heap.end());
+                slot->value = std::move(heap.back());
+                heap.pop_back();
+            } else {
+                slot->value.reset();
+            }
+        }
+
+        size_t remaining = pushes.size() - next_push;
+        if (remaining > heap.size() / 4) {
+            // bulk heapify is O(n + k), cheaper than k sift-ups once k is a sizeable fraction of n
+            for (size_t i = next_push; i < pushes.size(); ++i) heap.push_back(std::move(*pushes[i]->value));
+            std::make_heap(heap.begin(), heap.end());
+        } else {
+            for (size_t i = next_push; i < pushes.size(); ++i) {
+                heap.push_back(std::move(*pushes[i]->value));
+                std::push_heap(heap.begin(), heap.end());
+            }
+        }
+        count.store(heap.size(), std::memory_order_relaxed);
+
+        for (Slot* slot : pushes) slot->request.store(DONE, std::memory_order_release);
+        for (Slot* slot : pops) slot->request.store(DONE, std::memory_order_release);
+    }
+
+    // publishes the request and returns once some combiner (possibly us) has applied it
+    void execute(Slot& slot, Request request) {
+        slot.request.store(request, std::memory_order_release);
+        while (true) {
+            if (combiner.try_lock()) {
+                combine();
+                combiner.unlock();
+            }
+            if (slot.request.load(std::memory_order_acquire) == DONE) break;
+            std::this_thread::yield();
+        }
+        slot.request.store(IDLE, std::memory_order_relaxed);
+    }
+
+public:
+    FlatCombiningPriorityQueue() = default;
+
+    FlatCombiningPriorityQueue(const FlatCombiningPriorityQueue&) = delete;
+    FlatCombiningPriorityQueue& operator=(const FlatCombiningPriorityQueue&) = delete;
+
+    void push(const T& value) {
+        push(T(value));
+    }
+
+    void push(T&& value) {
+        Slot& slot = claim_slot();
+        slot.value.emplace(std::move(value));
+        execute(slot, PUSH);
+        slot.owned.store(false, std::memory_order_release);
+    }
+
+    bool pop(T& value) {
+        Slot& slot = claim_slot();
+        execute(slot, POP);
+        bool found = slot.value.has_value();
+        if (found) {
+            value = std::move(*slot.value);
+            slot.value.reset();
+        }
+        slot.owned.store(false, std::memory_order_release);
+        return found;
+    }
+
+    bool empty() const {
+        return count.load(std::memory_order_relaxed) == 0;
+    }
+
+    size_t size() const {
+        return count.load(std::memory_order_relaxed);
+    }
+};
+
+// Epoch-based reclamation for the lock-free skiplist below.
+// Every operation announces the global epoch it started in. A node unlinked while
+// the global epoch was e can only still be referenced by operations announced at e
+// or earlier, so it is freed once the global epoch reaches e + 2. The epoch advances
+// when every in-flight operation has announced the current one.
+template <typename Node>
+class EpochReclaimer {
+private:
+    static constexpr size_t MAX_RECORDS = 128;
+    static constexpr size_t ADVANCE_THRESHOLD = 64;
+    static constexpr uint64_t QUIESCENT = ~uint64_t(0);
+
+    struct alignas(64) Record {
+        std::atomic<bool> owned{false};
+        std::atomic<uint64_t> epoch{QUIESCENT};
+        std::vector<Node*> limbo[3]; // bucket e % 3 holds nodes retired in epoch limbo_epoch[e % 3]
+        uint64_t limbo_epoch[3] = {0, 0, 0};
+    };
+
+    alignas(64) std::atomic<uint64_t> global_epoch{0};
+    Record records[MAX_RECORDS];
+
+    static void free_all(std::vector<Node*>& nodes) {
+        for (Node* node : nodes) delete node;
+        nodes.clear();
+    }
+
+    void try_advance() {
+        uint64_t current = global_epoch.load(std::memory_order_seq_cst);
+        for (auto& r : records) {
+            uint64_t e = r.epoch.load(std::memory_order_seq_cst);
+            if (e != QUIESCENT && e != current) return;
+        }
+        global_epoch.compare_exchange_strong(current, current + 1, std::memory_order_seq_cst);
+    }
+
+public:
+    class Guard {
+    private:
+        EpochReclaimer* domain;
+        Record* rec;
+
+    public:
+        explicit Guard(EpochReclaimer& d) : domain(&d), rec(nullptr) {
+            size_t start = std::hash<std::thread::id>()(std::this_thread::get_id()) % MAX_RECORDS;
+            while (!rec) {
+                for (size_t i = 0; i < MAX_RECORDS; ++i) {
+                    Record& r = domain->records[(start + i) % MAX_RECORDS];
+                    bool expected = false;
+                    if (!r.owned.load(std::memory_order_relaxed) &&
+                        r.owned.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+                        rec = &r;
+                        break;
+                    }
+                }
+                if (!rec) std::this_thread::yield();
+            }
+            // announce, then confirm the epoch did not move underneath the announcement
+            uint64_t e = domain->global_epoch.load(std::memory_order_seq_cst);
+            while (true) {
+                rec->epoch.store(e, std::memory_order_seq_cst);
+                uint64_t again = domain->global_epoch.load(std::memory_order_seq_cst);
+                if (again == e) break;
+                e = again;
+            }
+        }
+
+        Guard(const Guard&) = delete;
+        Guard& operator=(const Guard&) = delete;
+
+        ~Guard() {
+            rec->epoch.store(QUIESCENT, std::memory_order_seq_cst);
+            rec->owned.store(false, std::memory_order_release);
+        }
+
+        // node must already be unreachable for operations that start from now on
+        void retire(Node* node) {
+            uint64_t e = domain->global_epoch.load(std::memory_order_seq_cst);
+            size_t bucket = e % 3;
+            if (rec->limbo_epoch[bucket] != e) {
+                // anything left here is from epoch e - 3 or older and safe to free
+                free_all(rec->limbo[bucket]);
+                rec->limbo_epoch[bucket] = e;
+            }
+            rec->limbo[bucket].push_back(node);
+            if (rec->limbo[bucket].size() % ADVANCE_THRESHOLD == 0) domain->try_advance();
+
+            uint64_t now = domain->global_epoch.load(std::memory_order_seq_cst);
+            for (size_t b = 0; b < 3; ++b) {
+                if (!rec->limbo[b].empty() && rec->limbo_epoch[b] + 2 <= now) free_all(rec->limbo[b]);
+            }
+        }
+    };
+
+    EpochReclaimer() = default;
+    EpochReclaimer(const EpochReclaimer&) = delete;
+    EpochReclaimer& operator=(const EpochReclaimer&) = delete;
+
+    ~EpochReclaimer() {
+        for (auto& r : records) {
+            for (auto& bucket : r.limbo) free_all(bucket);
+        }
+    }
+};
+
+// Lock-free skiplist Priority Queue (Linden-Jonsson).
+// Items are kept in a skiplist sorted highest-first. pop claims the first live node
+// by setting the delete bit carried in the low bit of its predecessor's level-0
+// pointer, so logically deleted nodes form a prefix of the list. That prefix is only
+// unlinked physically, in one CAS of the head pointer, once it grows past
+// BOUND_OFFSET nodes; the unlinked batch is then reclaimed through EpochReclaimer.
+// Same push/pop/empty/size API as ThreadSafePriorityQueue. pop copies the value out
+// because concurrent inserters may still be comparing against a deleted node.
+template <typename T>
+class LockFreeSkipListPriorityQueue {
+private:
+    static constexpr int MAX_LEVEL = 24;
+    static constexpr int BOUND_OFFSET = 32;
+
+    struct Node {
+        std::optional<T> value; // empty for the head/tail sentinels
+        int level;
+        std::atomic<bool> inserting{false};
+        std::unique_ptr<std::atomic<uintptr_t>[]> next;
+
+        explicit Node(int level) : level(level), next(new std::atomic<uintptr_t>[level]()) {}
+    };
+
+    static Node* unmarked(uintptr_t p) { return reinterpret_cast<Node*>(p & ~uintptr_t(1)); }
+    static bool is_marked(uintptr_t p) { return (p & 1) != 0; }
+    static uintptr_t as_link(Node* p) { return reinterpret_cast<uintptr_t>(p); }
+
+    Node* head;
+    Node* tail;
+    alignas(64) std::atomic<size_t> count{0};
+    EpochReclaimer<Node> epochs;
+
+    static int random_level() {
+        static thread_local std::minstd_rand gen(std::random_device{}());
+        int level = 1;
+        while (level < MAX_LEVEL && (gen() & 1)) ++level;
+        return level;
+    }
+
+    // node sorts strictly before an item with this value (higher priority first)
+    bool precedes(Node* node, const T& value) const {
+        return node != tail && value < *node->value;
+    }
+
+    // fills preds/succs for value on every level, skipping the deleted prefix;
+    // returns the last deleted node seen on level 0, if any
+    Node* locate_preds(const T& value, Node** preds, Node** succs) {
+        Node* del = nullptr;
+        Node* x = head;
+        for (int i = MAX_LEVEL - 1; i >= 0; --i) {
+            uintptr_t link = x->next[i].load(std::memory_order_acquire);
+            bool d = is_marked(link);
+            Node* x_next = unmarked(link);
+            while (precedes(x_next, value) ||
+                   is_marked(x_next->next[0].load(std::memory_order_acquire)) ||
+                   (i == 0 && d)) {
+                if (d && i == 0) del = x_next;
+                x = x_next;
+                link = x->next[i].load(std::memory_order_acquire);
+                d = is_marked(link);
+                x_next = unmarked(link);
+            }
+            preds[i] = x;
+            succs[i] = x_next;
+        }
+        return del;
+    }
+
+    // swings the head's upper-level pointers past the deleted prefix
+    void restructure() {
+        Node* pred = head;
+        for (int i = MAX_LEVEL - 1; i > 0;) {
+            uintptr_t h = head->next[i].load(std::memory_order_acquire);
+            Node* cur = unmarked(pred->next[i].load(std::memory_order_acquire));
+            if (!is_marked(unmarked(h)->next[0].load(std::memory_order_acquire))) {
+                --i;
+                continue;
+            }
+            while (is_marked(cur->next[0].load(std::memory_order_acquire))) {
+                pred = cur;
+                cur = unmarked(pred->next[i].load(std::memory_order_acquire));
+            }
+            if (head->next[i].compare_exchange_strong(h, pred->next[i].load(std::memory_order_acquire),
+                                                      std::memory_order_acq_rel)) {
+                --i;
+            }
+        }
+    }
+
+    void insert(Node* node) {
+        const T& value = *node->value;
+        Node* preds[MAX_LEVEL];
+        Node* succs[MAX_LEVEL];
+        typename EpochReclaimer<Node>::Guard guard(epochs);
+        count.fetch_add(1, std::memory_order_relaxed);
+
+        Node* del;
+        while (true) {
+            del = locate_preds(value, preds, succs);
+            node->next[0].store(as_link(succs[0]), std::memory_order_relaxed);
+            uintptr_t expected = as_link(succs[0]);
+            if (preds[0]->next[0].compare_exchange_strong(expected, as_link(node), std::memory_order_acq_rel)) break;
+        }
+
+        for (int i = 1; i < node->level;) {
+            node->next[i].store(as_link(succs[i]), std::memory_order_release);
+            // stop if the node (or its successor here) was already deleted
+            if (is_marked(node->next[0].load(std::memory_order_acquire)) ||
+                is_marked(succs[i]->next[0].load(std::memory_order_acquire)) || del == succs[i]) {
+                break;
+            }
+            uintptr_t expected = as_link(succs[i]);
+            if (preds[i]->next[i].compare_exchange_strong(expected, as_link(node), std::memory_order_acq_rel)) {
+                ++i;
+            } else {
+                del = locate_preds(value, preds, succs);
+                if (succs[0] != node) break;
+            }
+        }
+        node->inserting.store(false, std::memory_order_release);
+    }
+
+public:
+    LockFreeSkipListPriorityQueue() : head(new Node(MAX_LEVEL)), tail(new Node(MAX_LEVEL)) {
+        for (int i = 0; i < MAX_LEVEL; ++i) head->next[i].store(as_link(tail), std::memory_order_relaxed);
+    }
+
+    LockFreeSkipListPriorityQueue(const LockFreeSkipListPriorityQueue&) = delete;
+    LockFreeSkipListPriorityQueue& operator=(const LockFreeSkipListPriorityQueue&) = delete;
+
+    ~LockFreeSkipListPriorityQueue() {
+        Node* node = head;
+        while (node != tail) {
+            Node* next = unmarked(node->next[0].load(std::memory_order_relaxed));
+            delete node;
+            node = next;
+        }
+        delete tail;
+    }
+
+    void push(const T& value) {
+        push(T(value));
+    }
+
+    void push(T&& value) {
+        Node* node = new Node(random_level());
+        node->value.emplace(std::move(value));
+        node->inserting.store(true, std::memory_order_relaxed);
+        insert(node);
+    }
+
+    bool pop(T& value) {
+        typename EpochReclaimer<Node>::Guard guard(epochs);
+        Node* x = head;
+        Node* new_head = nullptr;
+        int offset = 0;
+        uintptr_t observed_head = head->next[0].load(std::memory_order_acquire);
+        uintptr_t link;
+        do {
+            link = x->next[0].load(std::memory_order_acquire);
+            if (unmarked(link) == tail) return false;
+            if (!new_head && x->inserting.load(std::memory_order_acquire)) new_head = x;
+            // claim the successor; if it was already claimed, keep walking the deleted prefix
+            link = x->next[0].fetch_or(1, std::memory_order_acq_rel);
+            ++offset;
+            x = unmarked(link);
+        } while (is_marked(link));
+
+        value = *x->value;
+        count.fetch_sub(1, std::memory_order_relaxed);
+        if (offset < BOUND_OFFSET) return true;
+
+        // unlink the deleted prefix in one step, stopping at nodes still being inserted
+        if (!new_head) new_head = x;
+        if (head->next[0].compare_exchange_strong(observed_head, as_link(new_head) | 1,
+                                                  std::memory_order_acq_rel)) {
+            restructure();
+            Node* cur = unmarked(observed_head);
+            while (cur != new_head) {
+                Node* next = unmarked(cur->next[0].load(std::memory_order_acquire));
+                guard.retire(cur);
+                cur = next;
+            }
+        }
         return true;
     }
 
     bool empty() const {
-        std::lock_guard<std::mutex> lock(mtx);
-        return pq.empty();
+        return count.load(std::memory_order_relaxed) == 0;
     }
 
     size_t size() const {
-        std::lock_guard<std::mutex> lock(mtx);
-        return pq.size();
+        return count.load(std::memory_order_relaxed);
     }
 };
 
 void priorityQueueTest() {
-    ThreadSafePriorityQueue<int> pq;
+    // priorities are drawn from 0..99, so the bucket queue applies
+    ThreadSafePriorityQueue<int, BoundedPriority<0, 99>> pq;
     std::vector<std::thread> threads;
     const int NUM_THREADS = 4;
     const int PUSHES_PER_THREAD = 5;
-    const int TOTAL_PUSHES = NUM_THREADS * PUSHES_PER_THREAD;
 
     std::atomic<int> pushed_count{0};
-    std::atomic<int> popped_count{0};
 
     // RNG per thread
     std::random_device rd;
@@ -72,16 +1962,11 @@ void priorityQueueTest() {
         }
     };
 
-    auto popper = [&pq, &popped_count]() {
-        while (popped_count < TOTAL_PUSHES) {
-            int value;
-            if (pq.pop(value)) {
-                ++popped_count;
-                std::cout << "Popper popped: " << value << "\n";
-            } else {
-                // queue empty for now, wait a bit
-                std::this_thread::sleep_for(std::chrono::milliseconds(50));
-            }
+    auto popper = [&pq]() {
+        int value;
+        // blocks while empty; returns false once the queue is closed and drained
+        while (pq.wait_pop(value)) {
+            std::cout << "Popper popped: " << value << "\n";
         }
     };
 
@@ -91,16 +1976,346 @@ void priorityQueueTest() {
     }
 
     // start single popper
-    threads.emplace_back(popper);
+    std::thread popper_thread(popper);
 
     for (auto& t : threads) {
         t.join();
     }
+    pq.close();
+    popper_thread.join();
 
     std::cout << "All done. final size: " << pq.size() << "\n";
 }
 
+// Re-prioritizes items from several threads through their handles. Updates
+// re-position items in place, so the heap holds exactly the live items, where
+// re-pushing with lazy deletion would hold one entry per update.
+void indexedPriorityQueueTest() {
+    const int ITEMS = 1000;
+    const int NUM_THREADS = 4;
+    const int UPDATES_PER_THREAD = 10000;
+    const int ERASED = 100;
+
+    ThreadSafeIndexedPriorityQueue<int> pq;
+    std::vector<ThreadSafeIndexedPriorityQueue<int>::Handle> handles;
+    for (int i = 0; i < ITEMS; ++i) handles.push_back(pq.push(i));
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < NUM_THREADS; ++t) {
+        threads.emplace_back([&pq, &handles, t]() {
+            std::mt19937 gen(t);
+            std::uniform_int_distribution<int> item(0, ITEMS - 1), priority(0, 1000000);
+            for (int i = 0; i < UPDATES_PER_THREAD; ++i) pq.update(handles[item(gen)], priority(gen));
+        });
+    }
+    for (auto& t : threads) t.join();
+    std::cout << "\nIndexed priority queue\n"
+              << NUM_THREADS * UPDATES_PER_THREAD << " updates on " << ITEMS << " items: size " << pq.size()
+              << " (lazy re-push would hold " << ITEMS + NUM_THREADS * UPDATES_PER_THREAD << " entries)\n";
+
+    for (int i = 0; i < ERASED; ++i) pq.erase(handles[i]);
+    const auto& stale = handles[0];
+    std::cout << "after erasing " << ERASED << ": size " << pq.size() << ", stale handle contains/update/erase: "
+              << pq.contains(stale) << "/" << pq.update(stale, 0) << "/" << pq.erase(stale) << "\n";
+
+    int value, previous = INT32_MAX, popped = 0;
+    bool ordered = true;
+    while (pq.pop(value)) {
+        ordered &= value <= previous;
+        previous = value;
+        ++popped;
+    }
+    std::cout << "popped " << popped << " items, " << (ordered ? "in priority order" : "OUT OF ORDER")
+              << "; handle of a popped item is live: " << pq.contains(handles[ITEMS - 1]) << "\n";
+}
+
+template <typename Backend>
+void delayQueueRun(const char* name, DelayQueue<int, Backend>& dq, int num_timers) {
+    using Clock = std::chrono::steady_clock;
+    std::mt19937 gen(7);
+    std::uniform_int_distribution<int> delay_ms(1, 200);
+
+    // deadlines[i] is when timer i is due; cancelled timers must never fire
+    std::vector<Clock::time_point> deadlines(num_timers);
+    std::vector<typename DelayQueue<int, Backend>::Handle> handles(num_timers);
+    auto base = Clock::now();
+    for (int i = 0; i < num_timers; ++i) {
+        deadlines[i] = base + std::chrono::milliseconds(delay_ms(gen));
+        handles[i] = dq.schedule(i, deadlines[i]);
+    }
+    int cancelled = 0;
+    for (int i = 0; i < num_timers; i += 10) {
+        dq.cancel(handles[i]);
+        deadlines[i] = Clock::time_point::max();
+        ++cancelled;
+    }
+    for (int i = 5; i < num_timers; i += 10) {
+        deadlines[i] = base + std::chrono::milliseconds(250);
+        dq.rearm(handles[i], deadlines[i]);
+    }
+
+    int fired = 0, early = 0;
+    Clock::duration max_late{0};
+    int value;
+    while (fired + cancelled < num_timers && dq.pop(value)) {
+        auto now = Clock::now();
+        if (now < deadlines[value]) ++early;
+        else max_late = std::max(max_late, now - deadlines[value]);
+        ++fired;
+    }
+    std::cout << name << ": " << fired << " fired, " << cancelled << " cancelled, " << early
+              << " early, max lateness "
+              << std::chrono::duration_cast<std::chrono::microseconds>(max_late).count() << " us\n";
+}
+
+void delayQueueTest() {
+    std::cout << "\nDelay queue\n";
+    DelayQueue<int> heap_queue;
+    delayQueueRun("heap timers", heap_queue, 1000);
+    DelayQueue<int, TimingWheelTimers<int>> wheel_queue;
+    delayQueueRun("timing wheel", wheel_queue, 100000);
+
+    // close releases a consumer blocked on a far-off deadline
+    DelayQueue<int> pending;
+    pending.schedule_after(0, std::chrono::hours(1));
+    std::thread consumer([&pending]() {
+        int value;
+        std::cout << "blocked pop returned " << (pending.pop(value) ? "an item" : "false (closed)") << "\n";
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    pending.close();
+    consumer.join();
+}
+
+// Sustained overload: each round submits slightly more high-priority work than one
+// round can run, plus a trickle of low-priority tasks. Without aging the low class
+// waits for the backlog to clear; with aging its delay is bounded by the key offset.
+void executorRun(const char* name, std::chrono::steady_clock::duration aging_step) {
+    using Clock = std::chrono::steady_clock;
+    const int ROUNDS = 150;
+    const int HIGH_PER_ROUND = 60;
+    const int LOW_PER_ROUND = 2;
+    const auto TASK_COST = std::chrono::microseconds(20);
+    const auto ROUND = std::chrono::milliseconds(1);
+
+    auto spin = [TASK_COST]() {
+        auto until = Clock::now() + TASK_COST;
+        while (Clock::now() < until) {
+        }
+    };
+
+    PriorityExecutor executor(2, 8, aging_step);
+    auto next_round = Clock::now();
+    for (int r = 0; r < ROUNDS; ++r) {
+        for (int i = 0; i < HIGH_PER_ROUND; ++i) executor.submit(7, spin);
+        for (int i = 0; i < LOW_PER_ROUND; ++i) executor.submit(0, spin);
+        next_round += ROUND;
+        std::this_thread::sleep_until(next_round);
+    }
+    executor.shutdown();
+
+    std::cout << name << "\n";
+    for (int priority : {7, 0}) {
+        auto stats = executor.delay_stats(priority);
+        auto us = [](Clock::duration d) { return std::chrono::duration_cast<std::chrono::microseconds>(d).count(); };
+        std::cout << "  priority " << priority << ": " << stats.count << " tasks, mean " << us(stats.mean)
+                  << " us, p99 <= " << us(stats.p99) << " us, max " << us(stats.max) << " us\n";
+    }
+}
+
+void executorBenchmark() {
+    std::cout << "\nPriority executor queueing delay under overload\n";
+    executorRun("strict priority (no aging)", std::chrono::hours(1));
+    executorRun("aging step 2 ms", std::chrono::milliseconds(2));
+}
+
+// Mixed push/pop throughput: each thread alternates push and pop on a queue
+// prefilled with PREFILL items.
+template <typename PQ>
+double priorityQueueThroughput(int num_threads, int ops_per_thread) {
+    const int PREFILL = 10000;
+    PQ pq;
+    for (int i = 0; i < PREFILL; ++i) pq.push((i * 7919) % 100000);
+
+    std::vector<std::thread> threads;
+    auto start = std::chrono::steady_clock::now();
+    for (int t = 0; t < num_threads; ++t) {
+        threads.emplace_back([&pq, t, ops_per_thread]() {
+            std::mt19937 gen(t);
+            std::uniform_int_distribution<int> dist(0, 99999);
+            int value;
+            for (int i = 0; i < ops_per_thread / 2; ++i) {
+                pq.push(dist(gen));
+                pq.pop(value);
+            }
+        });
+    }
+    for (auto& t : threads) t.join();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return num_threads * (ops_per_thread / 2) * 2 / elapsed.count();
+}
+
+void flatCombiningBenchmark() {
+    const int OPS_PER_THREAD = 100000;
+    const int thread_counts[] = {1, 4, 16};
+
+    std::cout << "\nFlat-combining vs mutex-per-op throughput\n";
+    for (int n : thread_counts) {
+        double locked = priorityQueueThroughput<ThreadSafePriorityQueue<int>>(n, OPS_PER_THREAD);
+        double combining = priorityQueueThroughput<FlatCombiningPriorityQueue<int>>(n, OPS_PER_THREAD);
+        std::cout << n << " threads  mutex: " << static_cast<long>(locked)
+                  << " ops/s  flat-combining: " << static_cast<long>(combining) << " ops/s\n";
+    }
+}
+
+void skipListBenchmark() {
+    const int OPS_PER_THREAD = 100000;
+    const int thread_counts[] = {1, 4, 16, 48};
+
+    std::cout << "\nLock-free skiplist vs heap wrapper throughput\n";
+    for (int n : thread_counts) {
+        double locked = priorityQueueThroughput<ThreadSafePriorityQueue<int>>(n, OPS_PER_THREAD);
+        double skiplist = priorityQueueThroughput<LockFreeSkipListPriorityQueue<int>>(n, OPS_PER_THREAD);
+        std::cout << n << " threads  heap: " << static_cast<long>(locked)
+                  << " ops/s  skiplist: " << static_cast<long>(skiplist) << " ops/s\n";
+    }
+}
+
+void multiQueueBenchmark() {
+    const int OPS_PER_THREAD = 100000;
+    const int thread_counts[] = {1, 4, 16};
+
+    std::cout << "\nMultiQueue vs single heap throughput\n";
+    for (int n : thread_counts) {
+        double locked = priorityQueueThroughput<ThreadSafePriorityQueue<int>>(n, OPS_PER_THREAD);
+        double multi = priorityQueueThroughput<MultiQueuePriorityQueue<int>>(n, OPS_PER_THREAD);
+        std::cout << n << " threads  single heap: " << static_cast<long>(locked)
+                  << " ops/s  multiqueue: " << static_cast<long>(multi) << " ops/s\n";
+    }
+}
+
+// Fixed-size element with an int priority, for measuring heaps over larger items.
+template <size_t Bytes>
+struct SizedItem {
+    int key = 0;
+    char payload[Bytes - sizeof(int)] = {};
+
+    SizedItem() = default;
+    SizedItem(int k) : key(k) {}
+    bool operator<(const SizedItem& other) const { return key < other.key; }
+};
+
+// no payload: a zero-length array would not be standard C++
+template <>
+struct SizedItem<sizeof(int)> {
+    int key = 0;
+
+    SizedItem() = default;
+    SizedItem(int k) : key(k) {}
+    bool operator<(const SizedItem& other) const { return key < other.key; }
+};
+
+// Single-threaded cost of filling a heap with n random items and draining it.
+template <typename Item, typename PQ>
+double heapFillDrainMs(int n) {
+    PQ pq;
+    std::mt19937 gen(42);
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < n; ++i) pq.push(static_cast<int>(gen()));
+    Item value;
+    while (pq.pop(value)) {}
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+template <size_t Bytes>
+void heapAritiesFor(int n) {
+    using Item = SizedItem<Bytes>;
+    std::cout << Bytes << "-byte items  std::priority_queue: "
+              << heapFillDrainMs<Item, ThreadSafePriorityQueue<Item>>(n) << " ms  2-ary: "
+              << heapFillDrainMs<Item, ThreadSafePriorityQueue<Item, DaryHeap<Item, 2>>>(n) << " ms  4-ary: "
+              << heapFillDrainMs<Item, ThreadSafePriorityQueue<Item, DaryHeap<Item, 4>>>(n) << " ms  8-ary: "
+              << heapFillDrainMs<Item, ThreadSafePriorityQueue<Item, DaryHeap<Item, 8>>>(n) << " ms\n";
+}
+
+// Cold-start refill: n single pushes versus one bulk heapify.
+void bulkRefillBenchmark() {
+    const int ITEMS = 1000000;
+    std::vector<int> snapshot(ITEMS);
+    std::mt19937 gen(7);
+    for (auto& v : snapshot) v = static_cast<int>(gen());
+
+    auto start = std::chrono::steady_clock::now();
+    {
+        ThreadSafePriorityQueue<int> pq;
+        for (int v : snapshot) pq.push(v);
+    }
+    std::chrono::duration<double, std::milli> one_by_one = std::chrono::steady_clock::now() - start;
+
+    start = std::chrono::steady_clock::now();
+    {
+        ThreadSafePriorityQueue<int> pq;
+        pq.push_bulk(snapshot.begin(), snapshot.end());
+    }
+    std::chrono::duration<double, std::milli> bulk = std::chrono::steady_clock::now() - start;
+
+    std::cout << "\nRefill " << ITEMS << " items  push loop: " << one_by_one.count()
+              << " ms  push_bulk: " << bulk.count() << " ms\n";
+}
+
+// time to fold a failed shard of ITEMS items into a sibling of the same size
+template <typename Heap>
+double mergeMs(const std::vector<int>& snapshot) {
+    ThreadSafePriorityQueue<int, Heap> survivor, failed;
+    survivor.push_bulk(snapshot.begin(), snapshot.end());
+    failed.push_bulk(snapshot.begin(), snapshot.end());
+    auto start = std::chrono::steady_clock::now();
+    survivor.merge_from(std::move(failed));
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+void mergeBenchmark() {
+    const int ITEMS = 1000000;
+    std::vector<int> snapshot(ITEMS);
+    std::mt19937 gen(11);
+    for (auto& v : snapshot) v = static_cast<int>(gen());
+
+    // the old way: drain one queue into the other item by item
+    ThreadSafePriorityQueue<int> survivor, failed;
+    survivor.push_bulk(snapshot.begin(), snapshot.end());
+    failed.push_bulk(snapshot.begin(), snapshot.end());
+    auto start = std::chrono::steady_clock::now();
+    int value;
+    while (failed.pop(value)) survivor.push(value);
+    std::chrono::duration<double, std::milli> drain = std::chrono::steady_clock::now() - start;
+
+    std::cout << "\nMerge two queues of " << ITEMS << " items\n"
+              << "pop/push loop: " << drain.count() << " ms\n"
+              << "merge_from std::priority_queue: " << mergeMs<std::priority_queue<int>>(snapshot) << " ms\n"
+              << "merge_from DaryHeap<4>: " << mergeMs<DaryHeap<int, 4>>(snapshot) << " ms\n"
+              << "merge_from PairingHeap: " << mergeMs<PairingHeap<int>>(snapshot) << " ms\n";
+}
+
+void heapArityBenchmark() {
+    const int ITEMS = 500000;
+
+    std::cout << "\nHeap arity vs element size (fill + drain " << ITEMS << " items)\n";
+    heapAritiesFor<4>(ITEMS);
+    heapAritiesFor<16>(ITEMS);
+    heapAritiesFor<64>(ITEMS);
+}
+
 int main() {
     priorityQueueTest();
+    indexedPriorityQueueTest();
+    delayQueueTest();
+    executorBenchmark();
+    flatCombiningBenchmark();
+    skipListBenchmark();
+    multiQueueBenchmark();
+    heapArityBenchmark();
+    bulkRefillBenchmark();
+    mergeBenchmark();
     return 0;
 }
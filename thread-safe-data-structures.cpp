@@ -1,34 +1,395 @@
 #include <queue>
+#include <deque>
 #include <stack>
 #include <mutex>
+#include <condition_variable>
 #include <thread>
 #include <vector>
 #include <string>
 #include <chrono>
 #include <iostream>
 #include <atomic>
+#include <optional>
+#include <algorithm>
+#include <functional>
+#include <new>
+#include <memory>
+#include <type_traits>
+
+// Segmented storage for ThreadSafeQueue built from fixed-size, cache-aligned chunks.
+// Chunks emptied by pop_front are kept on a free list (up to retained_chunks) and
+// reused by push_back, so a queue that oscillates within its retained capacity
+// never touches the heap. shrink_to_fit hands every cached chunk back to the heap.
+// Meets the std::queue container requirements.
+template <typename T, size_t ChunkCapacity = (sizeof(T) < 4096 ? 4096 / sizeof(T) : 1)>
+class ChunkedStorage {
+private:
+    struct alignas(64) Chunk {
+        Chunk* next = nullptr;
+        alignas(T) unsigned char storage[sizeof(T) * ChunkCapacity];
+
+        // raw memory of slot i, the target of placement new
+        void* slot(size_t i) { return storage + i * sizeof(T); }
+        // the live item in slot i
+        T* item(size_t i) { return std::launder(static_cast<T*>(slot(i))); }
+    };
+
+    Chunk* head = nullptr;
+    Chunk* tail = nullptr;
+    size_t head_pos = 0;
+    size_t tail_pos = 0;
+    size_t count = 0;
+
+    // free-chunk pool; stays with this object across swap()
+    Chunk* free_chunks = nullptr;
+    size_t free_count = 0;
+    size_t retained_chunks;
+
+    static inline std::atomic<size_t> allocations{0};
+
+    Chunk* acquire_chunk() {
+        if (!free_chunks) {
+            allocations.fetch_add(1, std::memory_order_relaxed);
+            return new Chunk;
+        }
+        Chunk* chunk = free_chunks;
+        free_chunks = chunk->next;
+        chunk->next = nullptr;
+        --free_count;
+        return chunk;
+    }
+
+    void release_chunk(Chunk* chunk) {
+        if (free_count >= retained_chunks) {
+            delete chunk;
+            return;
+        }
+        chunk->next = free_chunks;
+        free_chunks = chunk;
+        ++free_count;
+    }
+
+    void clear() {
+        while (count > 0) pop_front();
+        if (head) release_chunk(head);
+        head = tail = nullptr;
+        head_pos = tail_pos = 0;
+    }
+
+public:
+    using value_type = T;
+    using size_type = size_t;
+    using reference = T&;
+    using const_reference = const T&;
+
+    static constexpr size_t DEFAULT_RETAINED_CHUNKS = 16;
+
+    explicit ChunkedStorage(size_t retained_chunks = DEFAULT_RETAINED_CHUNKS)
+        : retained_chunks(retained_chunks) {}
+
+    ChunkedStorage(const ChunkedStorage&) = delete;
+    ChunkedStorage& operator=(const ChunkedStorage&) = delete;
+
+    ChunkedStorage(ChunkedStorage&& other) noexcept : retained_chunks(other.retained_chunks) {
+        swap(other);
+    }
+
+    ChunkedStorage& operator=(ChunkedStorage&& other) noexcept {
+        swap(other);
+        return *this;
+    }
+
+    ~ChunkedStorage() {
+        clear();
+        shrink_to_fit();
+    }
+
+    T& front() { return *head->item(head_pos); }
+    const T& front() const { return *head->item(head_pos); }
+    T& back() { return *tail->item(tail_pos - 1); }
+    const T& back() const { return *tail->item(tail_pos - 1); }
+
+    bool empty() const { return count == 0; }
+    size_t size() const { return count; }
+
+    template <typename... Args>
+    T& emplace_back(Args&&... args) {
+        if (tail && tail_pos < ChunkCapacity) {
+            T* item = new (tail->slot(tail_pos)) T(std::forward<Args>(args)...);
+            ++tail_pos;
+            ++count;
+            return *item;
+        }
+        // construct before linking: if T's constructor throws, the chunk goes back
+        // to the pool and the series is unchanged (count == 0 keeps head == tail)
+        Chunk* chunk = acquire_chunk();
+        T* item;
+        try {
+            item = new (chunk->slot(0)) T(std::forward<Args>(args)...);
+        } catch (...) {
+            release_chunk(chunk);
+            throw;
+        }
+        if (tail) tail->next = chunk;
+        else head = chunk, head_pos = 0;
+        tail = chunk;
+        tail_pos = 1;
+        ++count;
+        return *item;
+    }
+
+    void push_back(const T& value) { emplace_back(value); }
+    void push_back(T&& value) { emplace_back(std::move(value)); }
+
+    void pop_front() {
+        head->item(head_pos)->~T();
+        ++head_pos;
+        --count;
+        if (count == 0) {
+            // head == tail here; rewind so the chunk is reused from the start
+            head_pos = tail_pos = 0;
+        } else if (head_pos == ChunkCapacity) {
+            Chunk* old = head;
+            head = head->next;
+            head_pos = 0;
+            release_chunk(old);
+        }
+    }
+
+    // shrink_to_fit returns all pooled chunks (and the current chunk, if empty) to the heap.
+    void shrink_to_fit() {
+        if (count == 0 && head) {
+            delete head;
+            head = tail = nullptr;
+            head_pos = tail_pos = 0;
+        }
+        while (free_chunks) {
+            Chunk* next = free_chunks->next;
+            delete free_chunks;
+            free_chunks = next;
+        }
+        free_count = 0;
+    }
+
+    // reclaim takes over the chunks of an emptied storage (its current chunk and its
+    // pool) into this pool, up to this storage's cap; other is left without chunks.
+    void reclaim(ChunkedStorage& other) {
+        if (other.count != 0) return;
+        if (other.head) release_chunk(other.head);
+        other.head = other.tail = nullptr;
+        other.head_pos = other.tail_pos = 0;
+        while (other.free_chunks) {
+            Chunk* chunk = other.free_chunks;
+            other.free_chunks = chunk->next;
+            release_chunk(chunk);
+        }
+        other.free_count = 0;
+    }
+
+    size_t retention() const { return retained_chunks; }
+
+    // chunk_allocations counts chunks taken from the heap by every ChunkedStorage of this type.
+    static size_t chunk_allocations() { return allocations.load(std::memory_order_relaxed); }
+
+    // swap exchanges the stored items only; each side keeps its own chunk pool and cap.
+    void swap(ChunkedStorage& other) noexcept {
+        std::swap(head, other.head);
+        std::swap(tail, other.tail);
+        std::swap(head_pos, other.head_pos);
+        std::swap(tail_pos, other.tail_pos);
+        std::swap(count, other.count);
+    }
+
+    friend void swap(ChunkedStorage& a, ChunkedStorage& b) noexcept { a.swap(b); }
+};
+
+// true for backing stores whose chunks drain_all hands back after swapping them out
+template <typename Container>
+struct RecyclesChunks : std::false_type {};
+
+template <typename T, size_t ChunkCapacity>
+struct RecyclesChunks<ChunkedStorage<T, ChunkCapacity>> : std::true_type {};
 
 // Thread-safe Queue class
-template <typename T>
+// Container is the std::queue backing store: std::deque by default, or
+// ChunkedStorage<T> for allocation-free steady state under bursty load.
+template <typename T, typename Container = std::deque<T>>
 class ThreadSafeQueue {
 private:
-    std::queue<T> queue;
+    // std::queue with the backing container reachable for shrink_to_fit
+    struct Storage : std::queue<T, Container> {
+        using std::queue<T, Container>::c;
+
+        Storage() = default;
+        explicit Storage(Container&& storage) : std::queue<T, Container>(std::move(storage)) {}
+    };
+
+    Storage queue;
     std::mutex mtx;
+    std::condition_variable not_empty;
+    size_t waiters = 0; // consumers blocked in wait_pop*, guarded by mtx
+    bool closed = false;
+
+    bool take(T& value) {
+        if (queue.empty()) return false;
+        value = std::move(queue.front());
+        queue.pop();
+        return true;
+    }
+
+    template <typename... Args>
+    bool insert(Args&&... args) {
+        bool wake;
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            if (closed) return false;
+            queue.emplace(std::forward<Args>(args)...);
+            wake = waiters > 0;
+        }
+        // skip the notify syscall entirely when nobody is blocked
+        if (wake) not_empty.notify_one();
+        return true;
+    }
+
+    // an empty store like the queue's own, so drained ChunkedStorage chunks pool under the same cap
+    Storage empty_storage() const {
+        if constexpr (RecyclesChunks<Container>::value) {
+            return Storage(Container(queue.c.retention()));
+        } else {
+            return Storage();
+        }
+    }
 
 public:
     ThreadSafeQueue() {}
 
-    void push(T value) {
-        std::lock_guard<std::mutex> lock(mtx);
-        queue.push(value);
+    // e.g. ThreadSafeQueue<T, ChunkedStorage<T>> q(ChunkedStorage<T>(64)) to retain up to 64 chunks
+    explicit ThreadSafeQueue(Container storage) : queue(std::move(storage)) {}
+
+    // returns false if the queue was closed.
+    bool push(T value) {
+        return insert(std::move(value));
+    }
+
+    // emplace constructs the item in place while holding the lock.
+    // returns false if the queue was closed.
+    template <typename... Args>
+    bool emplace(Args&&... args) {
+        return insert(std::forward<Args>(args)...);
+    }
+
+    // push_range/push_bulk append a whole batch under a single lock acquisition.
+    // returns false (and pushes nothing) if the queue was closed.
+    template <typename InputIt>
+    bool push_range(InputIt first, InputIt last) {
+        size_t pushed = 0;
+        bool wake;
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            if (closed) return false;
+            for (; first != last; ++first, ++pushed) queue.emplace(*first);
+            wake = waiters > 0;
+        }
+        if (wake) {
+            if (pushed == 1) not_empty.notify_one();
+            else if (pushed > 1) not_empty.notify_all();
+        }
+        return true;
+    }
+
+    bool push_bulk(std::vector<T>&& values) {
+        bool ok = push_range(std::make_move_iterator(values.begin()), std::make_move_iterator(values.end()));
+        if (ok) values.clear();
+        return ok;
     }
 
     bool pop(T& value) {
         std::lock_guard<std::mutex> lock(mtx);
-        if (queue.empty()) return false;
-        value = queue.front();
+        return take(value);
+    }
+
+    // try_pop returns the front item, or an empty optional if the queue is empty.
+    std::optional<T> try_pop() {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (queue.empty()) return std::nullopt;
+        std::optional<T> value(std::move(queue.front()));
         queue.pop();
-        return true;
+        return value;
+    }
+
+    // pop_bulk moves up to max items to out under a single lock acquisition.
+    // returns the number of items popped; does not block.
+    template <typename OutputIt>
+    size_t pop_bulk(OutputIt out, size_t max) {
+        std::lock_guard<std::mutex> lock(mtx);
+        size_t popped = 0;
+        for (; popped < max && !queue.empty(); ++popped) {
+            *out++ = std::move(queue.front());
+            queue.pop();
+        }
+        return popped;
+    }
+
+    // drain_all swaps the whole backing container out in O(1) and appends its
+    // items to out after the lock is released. returns the number of items drained.
+    // With ChunkedStorage the drained chunks then go back to the queue's pool, so
+    // the next pushes reuse them instead of allocating.
+    size_t drain_all(std::vector<T>& out) {
+        Storage drained = empty_storage();
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            drained.swap(queue);
+        }
+        size_t n = drained.size();
+        out.reserve(out.size() + n);
+        for (; !drained.empty(); drained.pop()) out.push_back(std::move(drained.front()));
+        if constexpr (RecyclesChunks<Container>::value) {
+            std::lock_guard<std::mutex> lock(mtx);
+            queue.c.reclaim(drained.c);
+        }
+        return n;
+    }
+
+    // wait_pop blocks until an item is available or the queue is closed.
+    // returns false if the queue is closed and no items remain.
+    bool wait_pop(T& value) {
+        std::unique_lock<std::mutex> lock(mtx);
+        ++waiters;
+        not_empty.wait(lock, [this] { return !queue.empty() || closed; });
+        --waiters;
+        return take(value);
+    }
+
+    // wait_pop_for/wait_pop_until block until an item is available, the queue is
+    // closed, or the timeout expires. returns false on timeout or closed and empty.
+    template <typename Rep, typename Period>
+    bool wait_pop_for(T& value, const std::chrono::duration<Rep, Period>& timeout) {
+        return wait_pop_until(value, std::chrono::steady_clock::now() + timeout);
+    }
+
+    template <typename Clock, typename Duration>
+    bool wait_pop_until(T& value, const std::chrono::time_point<Clock, Duration>& deadline) {
+        std::unique_lock<std::mutex> lock(mtx);
+        ++waiters;
+        not_empty.wait_until(lock, deadline, [this] { return !queue.empty() || closed; });
+        --waiters;
+        return take(value);
+    }
+
+    // close rejects further pushes and wakes all blocked consumers so they can
+    // drain what is left.
+    void close() {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            closed = true;
+        }
+        not_empty.notify_all();
+    }
+
+    // shrink_to_fit trims memory the backing container holds beyond its current items.
+    void shrink_to_fit() {
+        std::lock_guard<std::mutex> lock(mtx);
+        queue.c.shrink_to_fit();
     }
 
     bool empty() {
@@ -42,6 +403,472 @@ public:
     }
 };
 
+// Sharded relaxed-FIFO Queue for many producers.
+// Holds one ThreadSafeQueue per shard on its own cache lines. A producer always
+// pushes to the shard picked by its thread id, so items from one producer stay in
+// FIFO order; there is no global order across producers. A consumer starts at the
+// shard it last found work in and steals round-robin from the others when it is empty.
+template <typename T>
+class ShardedThreadSafeQueue {
+private:
+    struct alignas(64) Shard {
+        ThreadSafeQueue<T> queue;
+    };
+
+    std::vector<std::unique_ptr<Shard>> shards;
+
+    size_t home_shard() const {
+        return std::hash<std::thread::id>()(std::this_thread::get_id()) % shards.size();
+    }
+
+public:
+    explicit ShardedThreadSafeQueue(size_t num_shards = std::thread::hardware_concurrency()) {
+        if (num_shards == 0) num_shards = 1;
+        for (size_t i = 0; i < num_shards; ++i) shards.push_back(std::make_unique<Shard>());
+    }
+
+    void push(T value) {
+        shards[home_shard()]->queue.push(std::move(value));
+    }
+
+    template <typename... Args>
+    void emplace(Args&&... args) {
+        shards[home_shard()]->queue.emplace(std::forward<Args>(args)...);
+    }
+
+    // returns false only if every shard was empty during the sweep.
+    bool pop(T& value) {
+        // the consumer's cursor is remembered for the last queue it popped from only;
+        // switching to another instance restarts at the thread's home position, so
+        // queues never steer each other's consumers
+        struct Cursor {
+            const ShardedThreadSafeQueue* owner = nullptr;
+            size_t index = 0;
+        };
+        static thread_local Cursor cursor;
+        if (cursor.owner != this) {
+            cursor.owner = this;
+            cursor.index = home_shard();
+        }
+        const size_t n = shards.size();
+        for (size_t i = 0; i < n; ++i) {
+            size_t index = (cursor.index + i) % n;
+            if (shards[index]->queue.pop(value)) {
+                cursor.index = index;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    std::optional<T> try_pop() {
+        std::optional<T> value;
+        T item;
+        if (pop(item)) value.emplace(std::move(item));
+        return value;
+    }
+
+    bool empty() {
+        for (auto& shard : shards) {
+            if (!shard->queue.empty()) return false;
+        }
+        return true;
+    }
+
+    size_t size() {
+        size_t total = 0;
+        for (auto& shard : shards) total += shard->queue.size();
+        return total;
+    }
+};
+
+// Tag selecting the single-producer/single-consumer ThreadSafeQueue specialization:
+//     ThreadSafeQueue<T, SpscMode>
+struct SpscMode {};
+
+// Wait-free single-producer/single-consumer Queue.
+// Exactly one thread may push and exactly one (other) thread may pop. Items live
+// in a chain of ring blocks: each block has a producer-owned tail and consumer-owned
+// head on separate cache lines, and each side keeps a cached copy of the opposite
+// index so it only reads the shared line when it looks full/empty. Handoff uses
+// acquire/release only; a new block is allocated only when the current one is full.
+template <typename T>
+class ThreadSafeQueue<T, SpscMode> {
+private:
+    static constexpr size_t BLOCK_CAPACITY = 1024; // power of two
+    static constexpr size_t MASK = BLOCK_CAPACITY - 1;
+
+    struct Block {
+        alignas(64) std::atomic<size_t> head{0};
+        size_t cached_tail = 0; // consumer-local
+        alignas(64) std::atomic<size_t> tail{0};
+        size_t cached_head = 0; // producer-local
+        alignas(64) std::atomic<Block*> next{nullptr};
+        alignas(T) unsigned char storage[sizeof(T) * BLOCK_CAPACITY];
+
+        // raw memory of slot i, the target of placement new
+        void* slot(size_t i) { return storage + (i & MASK) * sizeof(T); }
+        // the live item in slot i
+        T* item(size_t i) { return std::launder(static_cast<T*>(slot(i))); }
+    };
+
+    alignas(64) Block* head_block; // consumer side
+    std::atomic<size_t> popped{0};
+    alignas(64) Block* tail_block; // producer side
+    std::atomic<size_t> pushed{0};
+
+public:
+    ThreadSafeQueue() : head_block(new Block), tail_block(head_block) {}
+
+    ThreadSafeQueue(const ThreadSafeQueue&) = delete;
+    ThreadSafeQueue& operator=(const ThreadSafeQueue&) = delete;
+
+    ~ThreadSafeQueue() {
+        Block* block = head_block;
+        while (block) {
+            size_t end = block->tail.load(std::memory_order_relaxed);
+            for (size_t i = block->head.load(std::memory_order_relaxed); i != end; ++i) block->item(i)->~T();
+            Block* next = block->next.load(std::memory_order_relaxed);
+            delete block;
+            block = next;
+        }
+    }
+
+    // producer only
+    template <typename... Args>
+    void emplace(Args&&... args) {
+        Block* block = tail_block;
+        size_t t = block->tail.load(std::memory_order_relaxed);
+        if (t - block->cached_head == BLOCK_CAPACITY) {
+            block->cached_head = block->head.load(std::memory_order_acquire);
+            if (t - block->cached_head == BLOCK_CAPACITY) {
+                // block full: continue in a fresh one; this block is never written again
+                Block* next = new Block;
+                new (next->slot(0)) T(std::forward<Args>(args)...);
+                next->tail.store(1, std::memory_order_relaxed);
+                block->next.store(next, std::memory_order_release);
+                tail_block = next;
+                pushed.store(pushed.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+                return;
+            }
+        }
+        new (block->slot(t)) T(std::forward<Args>(args)...);
+        block->tail.store(t + 1, std::memory_order_release);
+        pushed.store(pushed.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    // producer only
+    void push(T value) {
+        emplace(std::move(value));
+    }
+
+    // consumer only
+    bool pop(T& value) {
+        while (true) {
+            Block* block = head_block;
+            size_t h = block->head.load(std::memory_order_relaxed);
+            if (h == block->cached_tail) {
+                block->cached_tail = block->tail.load(std::memory_order_acquire);
+                if (h == block->cached_tail) {
+                    Block* next = block->next.load(std::memory_order_acquire);
+                    if (!next) return false;
+                    // the producer's last tail store happens-before publishing next
+                    block->cached_tail = block->tail.load(std::memory_order_acquire);
+                    if (h == block->cached_tail) {
+                        head_block = next;
+                        delete block;
+                        continue;
+                    }
+                }
+            }
+            T* item = block->item(h);
+            value = std::move(*item);
+            item->~T();
+            block->head.store(h + 1, std::memory_order_release);
+            popped.store(popped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+
+    // consumer only
+    std::optional<T> try_pop() {
+        T value;
+        if (!pop(value)) return std::nullopt;
+        return std::optional<T>(std::move(value));
+    }
+
+    // size and empty are approximate while the producer and consumer are running
+    size_t size() {
+        size_t out = popped.load(std::memory_order_relaxed);
+        size_t in = pushed.load(std::memory_order_relaxed);
+        return in > out ? in - out : 0;
+    }
+
+    bool empty() {
+        return size() == 0;
+    }
+};
+
+// Thread-safe Queue with separate head and tail locks (Michael-Scott two-lock queue).
+// A dummy node keeps head and tail from ever pointing at the same live element,
+// so push only touches the tail and pop only touches the head.
+template <typename T>
+class ThreadSafeTwoLockQueue {
+private:
+    struct Node {
+        std::optional<T> data;
+        std::atomic<Node*> next{nullptr};
+    };
+
+    Node* head;
+    Node* tail;
+    std::mutex head_mtx;
+    std::mutex tail_mtx;
+    std::atomic<size_t> count{0};
+
+public:
+    ThreadSafeTwoLockQueue() : head(new Node), tail(head) {}
+
+    ThreadSafeTwoLockQueue(const ThreadSafeTwoLockQueue&) = delete;
+    ThreadSafeTwoLockQueue& operator=(const ThreadSafeTwoLockQueue&) = delete;
+
+    ~ThreadSafeTwoLockQueue() {
+        while (head) {
+            Node* next = head->next.load(std::memory_order_relaxed);
+            delete head;
+            head = next;
+        }
+    }
+
+    void push(T value) {
+        Node* node = new Node;
+        node->data.emplace(std::move(value));
+        std::lock_guard<std::mutex> lock(tail_mtx);
+        count.fetch_add(1, std::memory_order_relaxed);
+        // release pairs with the acquire in pop when head == tail
+        tail->next.store(node, std::memory_order_release);
+        tail = node;
+    }
+
+    bool pop(T& value) {
+        Node* old_head;
+        {
+            std::lock_guard<std::mutex> lock(head_mtx);
+            Node* next = head->next.load(std::memory_order_acquire);
+            if (!next) return false;
+            value = std::move(*next->data);
+            next->data.reset();
+            old_head = head;
+            head = next;
+            count.fetch_sub(1, std::memory_order_relaxed);
+        }
+        delete old_head;
+        return true;
+    }
+
+    bool empty() {
+        std::lock_guard<std::mutex> lock(head_mtx);
+        return head->next.load(std::memory_order_acquire) == nullptr;
+    }
+
+    size_t size() {
+        return count.load(std::memory_order_relaxed);
+    }
+};
+
+// Hazard pointers for the lock-free structures below.
+// An operation claims a record, publishes every node it is about to dereference,
+// and hands unlinked nodes to retire(). A retired node is only deleted once no
+// record publishes it, which rules out both use-after-free and ABA on reuse.
+template <typename Node>
+class HazardPointers {
+public:
+    static constexpr size_t MAX_RECORDS = 128;
+    static constexpr size_t SLOTS_PER_RECORD = 2;
+    static constexpr size_t SCAN_THRESHOLD = 2 * MAX_RECORDS * SLOTS_PER_RECORD;
+
+private:
+    struct alignas(64) Record {
+        std::atomic<bool> active{false};
+        std::atomic<Node*> hazard[SLOTS_PER_RECORD] = {};
+        std::vector<Node*> retired; // only touched by the record's current owner
+    };
+
+    Record records[MAX_RECORDS];
+
+    void scan(Record& rec) {
+        std::vector<Node*> hazards;
+        hazards.reserve(MAX_RECORDS * SLOTS_PER_RECORD);
+        for (auto& r : records) {
+            for (auto& h : r.hazard) {
+                if (Node* p = h.load(std::memory_order_seq_cst)) hazards.push_back(p);
+            }
+        }
+        std::sort(hazards.begin(), hazards.end());
+
+        std::vector<Node*> still_hazardous;
+        for (Node* node : rec.retired) {
+            if (std::binary_search(hazards.begin(), hazards.end(), node)) still_hazardous.push_back(node);
+            else delete node;
+        }
+        rec.retired.swap(still_hazardous);
+    }
+
+public:
+    class Guard {
+    private:
+        HazardPointers* domain;
+        Record* rec;
+
+    public:
+        explicit Guard(HazardPointers& d) : domain(&d), rec(nullptr) {
+            size_t start = std::hash<std::thread::id>()(std::this_thread::get_id()) % MAX_RECORDS;
+            while (!rec) {
+                for (size_t i = 0; i < MAX_RECORDS; ++i) {
+                    Record& r = domain->records[(start + i) % MAX_RECORDS];
+                    bool expected = false;
+                    if (!r.active.load(std::memory_order_relaxed) &&
+                        r.active.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+                        rec = &r;
+                        break;
+                    }
+                }
+                if (!rec) std::this_thread::yield(); // more than MAX_RECORDS operations in flight
+            }
+        }
+
+        Guard(const Guard&) = delete;
+        Guard& operator=(const Guard&) = delete;
+
+        ~Guard() {
+            for (auto& h : rec->hazard) h.store(nullptr, std::memory_order_release);
+            rec->active.store(false, std::memory_order_release);
+        }
+
+        // Publishes src's current value in slot i; the returned node stays
+        // allocated until the slot is overwritten or the guard is destroyed.
+        Node* protect(size_t i, const std::atomic<Node*>& src) {
+            Node* p = src.load(std::memory_order_acquire);
+            while (true) {
+                rec->hazard[i].store(p, std::memory_order_seq_cst);
+                Node* again = src.load(std::memory_order_seq_cst);
+                if (again == p) return p;
+                p = again;
+            }
+        }
+
+        void retire(Node* node) {
+            rec->retired.push_back(node);
+            if (rec->retired.size() >= SCAN_THRESHOLD) domain->scan(*rec);
+        }
+    };
+
+    HazardPointers() = default;
+    HazardPointers(const HazardPointers&) = delete;
+    HazardPointers& operator=(const HazardPointers&) = delete;
+
+    ~HazardPointers() {
+        for (auto& r : records) {
+            for (Node* node : r.retired) delete node;
+        }
+    }
+};
+
+// Lock-free multi-producer/multi-consumer Queue (Michael-Scott), reclaimed with hazard pointers.
+// Same push/pop/empty/size contract as ThreadSafeQueue.
+template <typename T>
+class ThreadSafeLockFreeQueue {
+private:
+    struct Node {
+        std::atomic<Node*> next{nullptr};
+        std::optional<T> data;
+    };
+
+    alignas(64) std::atomic<Node*> head;
+    alignas(64) std::atomic<Node*> tail;
+    alignas(64) std::atomic<size_t> count{0};
+    HazardPointers<Node> hazards;
+
+public:
+    ThreadSafeLockFreeQueue() {
+        Node* dummy = new Node;
+        head.store(dummy, std::memory_order_relaxed);
+        tail.store(dummy, std::memory_order_relaxed);
+    }
+
+    ThreadSafeLockFreeQueue(const ThreadSafeLockFreeQueue&) = delete;
+    ThreadSafeLockFreeQueue& operator=(const ThreadSafeLockFreeQueue&) = delete;
+
+    ~ThreadSafeLockFreeQueue() {
+        Node* node = head.load(std::memory_order_relaxed);
+        while (node) {
+            Node* next = node->next.load(std::memory_order_relaxed);
+            delete node;
+            node = next;
+        }
+    }
+
+    void push(T value) {
+        Node* node = new Node;
+        node->data.emplace(std::move(value));
+        count.fetch_add(1, std::memory_order_relaxed);
+
+        typename HazardPointers<Node>::Guard guard(hazards);
+        while (true) {
+            Node* last = guard.protect(0, tail);
+            Node* next = last->next.load(std::memory_order_acquire);
+            if (last != tail.load(std::memory_order_acquire)) continue;
+            if (next == nullptr) {
+                if (last->next.compare_exchange_weak(next, node, std::memory_order_release,
+                                                     std::memory_order_relaxed)) {
+                    tail.compare_exchange_strong(last, node, std::memory_order_release,
+                                                 std::memory_order_relaxed);
+                    return;
+                }
+            } else {
+                // tail is lagging; help the other producer finish
+                tail.compare_exchange_weak(last, next, std::memory_order_release,
+                                           std::memory_order_relaxed);
+            }
+        }
+    }
+
+    bool pop(T& value) {
+        typename HazardPointers<Node>::Guard guard(hazards);
+        while (true) {
+            Node* first = guard.protect(0, head);
+            Node* last = tail.load(std::memory_order_acquire);
+            Node* next = guard.protect(1, first->next);
+            if (first != head.load(std::memory_order_acquire)) continue;
+            if (next == nullptr) return false;
+            if (first == last) {
+                tail.compare_exchange_weak(last, next, std::memory_order_release,
+                                           std::memory_order_relaxed);
+                continue;
+            }
+            if (head.compare_exchange_strong(first, next, std::memory_order_acq_rel,
+                                             std::memory_order_relaxed)) {
+                // next is the new dummy; its payload now belongs to us alone
+                value = std::move(*next->data);
+                next->data.reset();
+                count.fetch_sub(1, std::memory_order_relaxed);
+                guard.retire(first);
+                return true;
+            }
+        }
+    }
+
+    bool empty() {
+        typename HazardPointers<Node>::Guard guard(hazards);
+        Node* first = guard.protect(0, head);
+        return first->next.load(std::memory_order_acquire) == nullptr;
+    }
+
+    size_t size() {
+        return count.load(std::memory_order_relaxed);
+    }
+};
+
 // Thread-safe Stack class
 template <typename T>
 class ThreadSafeStack {
@@ -54,17 +881,33 @@ public:
 
     void push(T value) {
         std::lock_guard<std::mutex> lock(mtx);
-        stack.push(value);
+        stack.push(std::move(value));
+    }
+
+    // emplace constructs the item in place while holding the lock.
+    template <typename... Args>
+    void emplace(Args&&... args) {
+        std::lock_guard<std::mutex> lock(mtx);
+        stack.emplace(std::forward<Args>(args)...);
     }
 
     bool pop(T& value) {
         std::lock_guard<std::mutex> lock(mtx);
         if (stack.empty()) return false;
-        value = stack.top();
+        value = std::move(stack.top());
         stack.pop();
         return true;
     }
 
+    // try_pop returns the top item, or an empty optional if the stack is empty.
+    std::optional<T> try_pop() {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (stack.empty()) return std::nullopt;
+        std::optional<T> value(std::move(stack.top()));
+        stack.pop();
+        return value;
+    }
+
     bool empty() {
         std::lock_guard<std::mutex> lock(mtx);
         return stack.empty();
@@ -82,31 +925,23 @@ void producerConsumerProblem() {
     const int NUM_PRODUCERS = 3;
     const int NUM_CONSUMERS = 2;
     const int MESSAGES_PER_PRODUCER = 5;
-    std::atomic<int> messages_produced(0);
     std::vector<std::thread> producers;
     std::vector<std::thread> consumers;
 
-    auto producer = [&messageQueue, &messages_produced](int id) {
+    auto producer = [&messageQueue](int id) {
         for (int i = 0; i < MESSAGES_PER_PRODUCER; ++i) {
             std::string message = "Producer " + std::to_string(id) + " Message " + std::to_string(i);
             messageQueue.push(message);
-            messages_produced++;
             std::cout << "Produced: " << message << std::endl;
             std::this_thread::sleep_for(std::chrono::milliseconds(100));
         }
     };
 
-    auto consumer = [&messageQueue, &messages_produced](int id) {
-        int consumed = 0;
-        while (consumed < NUM_PRODUCERS * MESSAGES_PER_PRODUCER) {
-            std::string message;
-            if (messageQueue.pop(message)) {
-                std::cout << "Consumer " << id << " processed: " << message << std::endl;
-                consumed++;
-            } else if (messages_produced == NUM_PRODUCERS * MESSAGES_PER_PRODUCER) {
-                break; // All messages produced and queue empty
-            }
-            std::this_thread::sleep_for(std::chrono::milliseconds(150));
+    auto consumer = [&messageQueue](int id) {
+        std::string message;
+        // wait_pop returns false once the queue is closed and drained
+        while (messageQueue.wait_pop(message)) {
+            std::cout << "Consumer " << id << " processed: " << message << std::endl;
         }
     };
 
@@ -119,6 +954,8 @@ void producerConsumerProblem() {
     }
 
     for (auto& t : producers) t.join();
+    // all messages produced; consumers exit once the queue is drained
+    messageQueue.close();
     for (auto& t : consumers) t.join();
 }
 
@@ -165,6 +1002,271 @@ void undoRedoProblem() {
     editText("Hello Galaxy");
 }
 
+// Problem 3: Queue Throughput Benchmark
+// Each producer pushes its share, consumers pop until the total has been seen.
+// Any extra arguments are passed to the queue's constructor.
+template <typename Queue, typename... Args>
+double queueThroughput(int num_producers, int num_consumers, int items_per_producer, Args&&... queue_args) {
+    Queue queue(std::forward<Args>(queue_args)...);
+    const int total = num_producers * items_per_producer;
+    std::atomic<int> consumed(0);
+    std::vector<std::thread> threads;
+
+    auto start = std::chrono::steady_clock::now();
+    for (int p = 0; p < num_producers; ++p) {
+        threads.emplace_back([&queue, items_per_producer]() {
+            for (int i = 0; i < items_per_producer; ++i) queue.push(i);
+        });
+    }
+    for (int c = 0; c < num_consumers; ++c) {
+        threads.emplace_back([&queue, &consumed, total]() {
+            int value;
+            while (consumed.load(std::memory_order_relaxed) < total) {
+                if (queue.pop(value)) consumed.fetch_add(1, std::memory_order_relaxed);
+                else std::this_thread::yield();
+            }
+        });
+    }
+    for (auto& t : threads) t.join();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return total / elapsed.count();
+}
+
+void queueBenchmark() {
+    const int ITEMS_PER_PRODUCER = 200000;
+    const int configs[][2] = {{1, 1}, {4, 4}};
+
+    for (const auto& cfg : configs) {
+        double single = queueThroughput<ThreadSafeQueue<int>>(cfg[0], cfg[1], ITEMS_PER_PRODUCER);
+        double two_lock = queueThroughput<ThreadSafeTwoLockQueue<int>>(cfg[0], cfg[1], ITEMS_PER_PRODUCER);
+        std::cout << cfg[0] << "P/" << cfg[1] << "C  single-mutex: " << static_cast<long>(single)
+                  << " ops/s  two-lock: " << static_cast<long>(two_lock)
+                  << " ops/s  (x" << two_lock / single << ")\n";
+    }
+}
+
+// Problem 4: Lock-free Queue Stress and Scaling
+// Every thread alternates push/pop so the queue never runs dry; the checksum of
+// popped values (plus whatever is left at the end) must match what was pushed.
+template <typename Queue>
+bool queueStress(int num_threads, long long total_ops, double& ops_per_sec) {
+    Queue queue;
+    const long long pairs_per_thread = total_ops / 2 / num_threads;
+    std::atomic<long long> pushed_sum(0), popped_sum(0);
+    std::vector<std::thread> threads;
+
+    auto start = std::chrono::steady_clock::now();
+    for (int t = 0; t < num_threads; ++t) {
+        threads.emplace_back([&, t]() {
+            long long local_pushed = 0, local_popped = 0;
+            for (long long i = 0; i < pairs_per_thread; ++i) {
+                long long v = t * pairs_per_thread + i;
+                queue.push(v);
+                local_pushed += v;
+                long long out;
+                if (queue.pop(out)) local_popped += out;
+            }
+            pushed_sum += local_pushed;
+            popped_sum += local_popped;
+        });
+    }
+    for (auto& t : threads) t.join();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    ops_per_sec = 2.0 * pairs_per_thread * num_threads / elapsed.count();
+
+    long long out;
+    while (queue.pop(out)) popped_sum += out;
+    return pushed_sum == popped_sum && queue.empty();
+}
+
+void lockFreeQueueBenchmark() {
+    // raise to 1000000000 for the full billion-operation soak
+    const long long TOTAL_OPS = 2000000;
+    const int thread_counts[] = {1, 2, 4, 8, 16, 32, 64};
+
+    for (int n : thread_counts) {
+        double mutex_rate = 0, lock_free_rate = 0;
+        bool ok = queueStress<ThreadSafeQueue<long long>>(n, TOTAL_OPS, mutex_rate);
+        ok = queueStress<ThreadSafeLockFreeQueue<long long>>(n, TOTAL_OPS, lock_free_rate) && ok;
+        std::cout << n << " threads  mutex: " << static_cast<long>(mutex_rate)
+                  << " ops/s  lock-free: " << static_cast<long>(lock_free_rate)
+                  << " ops/s  " << (ok ? "checksum ok" : "CHECKSUM MISMATCH") << "\n";
+    }
+}
+
+// Problem 5: Batch Size vs Throughput
+// One producer and one consumer move the same number of items in batches of
+// the given size through push_bulk/pop_bulk.
+double batchThroughput(size_t batch, int total) {
+    ThreadSafeQueue<int> queue;
+    auto start = std::chrono::steady_clock::now();
+
+    std::thread producer([&queue, batch, total]() {
+        std::vector<int> chunk;
+        for (int i = 0; i < total;) {
+            chunk.clear();
+            for (size_t k = 0; k < batch && i < total; ++k) chunk.push_back(i++);
+            queue.push_bulk(std::move(chunk));
+        }
+    });
+    std::thread consumer([&queue, batch, total]() {
+        std::vector<int> chunk(batch);
+        for (int received = 0; received < total;) {
+            size_t n = queue.pop_bulk(chunk.begin(), batch);
+            if (n == 0) std::this_thread::yield();
+            received += static_cast<int>(n);
+        }
+    });
+    producer.join();
+    consumer.join();
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return total / elapsed.count();
+}
+
+void batchBenchmark() {
+    const int TOTAL_ITEMS = 1000000;
+    const size_t batch_sizes[] = {1, 8, 64, 512};
+
+    for (size_t batch : batch_sizes) {
+        std::cout << "batch " << batch << ": "
+                  << static_cast<long>(batchThroughput(batch, TOTAL_ITEMS)) << " items/s\n";
+    }
+}
+
+// Problem 6: SPSC Handoff Latency
+// Ping-pong a token between two threads over a pair of queues; half the round
+// trip is the one-way handoff latency.
+template <typename Queue>
+double handoffLatencyNs(int round_trips) {
+    Queue ping, pong;
+    std::thread echo([&ping, &pong, round_trips]() {
+        int token;
+        for (int i = 0; i < round_trips; ++i) {
+            while (!ping.pop(token)) std::this_thread::yield();
+            pong.push(token);
+        }
+    });
+
+    auto start = std::chrono::steady_clock::now();
+    int token;
+    for (int i = 0; i < round_trips; ++i) {
+        ping.push(i);
+        while (!pong.pop(token)) std::this_thread::yield();
+    }
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    echo.join();
+    return elapsed.count() / round_trips / 2;
+}
+
+void spscLatencyBenchmark() {
+    const int ROUND_TRIPS = 20000;
+    std::cout << "mutex queue: " << handoffLatencyNs<ThreadSafeQueue<int>>(ROUND_TRIPS) << " ns/handoff\n";
+    std::cout << "spsc queue:  " << handoffLatencyNs<ThreadSafeQueue<int, SpscMode>>(ROUND_TRIPS) << " ns/handoff\n";
+}
+
+// Problem 7: Sharded Queue Producer Scaling
+void shardedQueueBenchmark() {
+    const int ITEMS_PER_PRODUCER = 100000;
+    const int NUM_CONSUMERS = 2;
+    const int producer_counts[] = {1, 3, 8};
+
+    for (int producers : producer_counts) {
+        double single = queueThroughput<ThreadSafeQueue<int>>(producers, NUM_CONSUMERS, ITEMS_PER_PRODUCER);
+        // one shard per producer, independent of how many cores this machine has
+        double sharded = queueThroughput<ShardedThreadSafeQueue<int>>(producers, NUM_CONSUMERS, ITEMS_PER_PRODUCER,
+                                                                      static_cast<size_t>(producers));
+        std::cout << producers << "P/" << NUM_CONSUMERS << "C  single queue: " << static_cast<long>(single)
+                  << " ops/s  sharded (shards=" << producers << "): " << static_cast<long>(sharded) << " ops/s\n";
+    }
+}
+
+// Problem 8: Move-only Items
+// Items own a unique_ptr, so they can only be moved through the containers:
+// emplace builds them in place, and pop/try_pop/wait_pop move them out.
+struct Job {
+    int id;
+    std::unique_ptr<std::string> payload;
+
+    Job() : id(-1) {}
+    Job(int id, std::string text) : id(id), payload(std::make_unique<std::string>(std::move(text))) {}
+};
+
+void moveOnlyProblem() {
+    ThreadSafeQueue<Job> jobs;
+    const int NUM_JOBS = 5;
+
+    std::thread worker([&jobs]() {
+        Job job;
+        while (jobs.wait_pop(job)) {
+            std::cout << "Worker ran job " << job.id << ": " << *job.payload << std::endl;
+        }
+    });
+    for (int i = 0; i < NUM_JOBS; ++i) jobs.emplace(i, "task " + std::to_string(i));
+    jobs.push(Job(NUM_JOBS, "pushed by move"));
+    jobs.close();
+    worker.join();
+
+    ThreadSafeQueue<std::unique_ptr<int>> pointers;
+    pointers.push(std::make_unique<int>(1));
+    pointers.emplace(std::make_unique<int>(2));
+    std::optional<std::unique_ptr<int>> first = pointers.try_pop();
+    std::unique_ptr<int> second;
+    pointers.pop(second);
+    std::cout << "Queue try_pop: " << **first << ", pop: " << *second
+              << ", then empty try_pop: " << (pointers.try_pop() ? "item" : "nullopt") << std::endl;
+
+    ThreadSafeStack<std::unique_ptr<int>> stack;
+    stack.push(std::make_unique<int>(1));
+    stack.emplace(std::make_unique<int>(2));
+    std::optional<std::unique_ptr<int>> top = stack.try_pop();
+    std::unique_ptr<int> below;
+    stack.pop(below);
+    std::cout << "Stack try_pop: " << **top << ", pop: " << *below << std::endl;
+}
+
+// Problem 9: Chunk Reuse under Bursty Load
+// A queue backed by ChunkedStorage that fills and empties repeatedly should only
+// allocate chunks on the first burst; bursts larger than the retention cap
+// allocate only the excess; shrink_to_fit gives everything back.
+void chunkReuseProblem() {
+    using Storage = ChunkedStorage<int>; // 1024 ints per chunk
+    const int CHUNK = 1024;
+    const size_t RETAINED = 64;
+    ThreadSafeQueue<int, Storage> queue{Storage(RETAINED)};
+
+    auto burst = [&queue](int items) {
+        for (int i = 0; i < items; ++i) queue.push(i);
+        int value;
+        while (queue.pop(value)) {
+        }
+    };
+    auto allocated = [](auto&& run) {
+        size_t before = Storage::chunk_allocations();
+        run();
+        return Storage::chunk_allocations() - before;
+    };
+
+    std::cout << "first burst of 50 chunks: " << allocated([&] { burst(50 * CHUNK); }) << " chunks allocated\n";
+    std::cout << "100 more bursts of 50 chunks: "
+              << allocated([&] { for (int i = 0; i < 100; ++i) burst(50 * CHUNK); }) << " chunks allocated\n";
+    burst(100 * CHUNK); // grows past the cap once
+    std::cout << "10 bursts of 100 chunks (cap " << RETAINED << "): "
+              << allocated([&] { for (int i = 0; i < 10; ++i) burst(100 * CHUNK); }) << " chunks allocated\n";
+
+    std::vector<int> drained;
+    std::cout << "drain_all of 20 chunks, then refill: " << allocated([&] {
+        for (int i = 0; i < 20 * CHUNK; ++i) queue.push(i);
+        queue.drain_all(drained);
+        for (int i = 0; i < 20 * CHUNK; ++i) queue.push(i);
+    }) << " chunks allocated\n";
+    burst(0); // empties the refill
+
+    queue.shrink_to_fit();
+    std::cout << "after shrink_to_fit, a burst of 10 chunks: " << allocated([&] { burst(10 * CHUNK); })
+              << " chunks allocated\n";
+}
+
 int main() {
     std::cout << "Problem 1: Producer-Consumer Simulation\n";
     producerConsumerProblem();
@@ -172,5 +1274,26 @@ int main() {
     std::cout << "\nProblem 2: Undo-Redo System\n";
     undoRedoProblem();
 
+    std::cout << "\nProblem 3: Queue Throughput Benchmark\n";
+    queueBenchmark();
+
+    std::cout << "\nProblem 4: Lock-free Queue Stress and Scaling\n";
+    lockFreeQueueBenchmark();
+
+    std::cout << "\nProblem 5: Batch Size vs Throughput\n";
+    batchBenchmark();
+
+    std::cout << "\nProblem 6: SPSC Handoff Latency\n";
+    spscLatencyBenchmark();
+
+    std::cout << "\nProblem 7: Sharded Queue Producer Scaling\n";
+    shardedQueueBenchmark();
+
+    std::cout << "\nProblem 8: Move-only Items\n";
+    moveOnlyProblem();
+
+    std::cout << "\nProblem 9: Chunk Reuse under Bursty Load\n";
+    chunkReuseProblem();
+
     return 0;
 }
\ No newline at end of file